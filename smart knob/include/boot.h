@@ -0,0 +1,31 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <Arduino.h>
+
+// Boot timing. setup() only brings up what the first clock frame needs
+// (oled, RTC, ring, encoder) and paints it. Everything else is deferred
+// (benches, the RAM report) and run from loop(), one task per pass once the
+// clock is already on screen. The boot report is printed after the last one.
+//
+// boot_mark() timestamps the end of each stage. The report lists every
+// stage's duration and when the first frame went out, counted from when the
+// Arduino core started the timers.
+
+enum BootStage {
+  BOOT_SETUP,    // core init done, setup() entered
+  BOOT_SERIAL,
+  BOOT_DISPLAY,  // Wire + SSD1306 init sequence
+  BOOT_RTC,
+  BOOT_INPUT,    // ring, encoder pins and interrupt, trace player
+  BOOT_FRAME,    // first clock frame on the panel
+  BOOT_DEFERRED, // deferred tasks done, see boot_poll()
+  BOOT_STAGES
+};
+
+void boot_mark(BootStage stage);
+// runs tasks[] (a PROGMEM table) one per call, true once all are done
+bool boot_poll(void (*const *tasks)(), uint8_t count);
+void boot_report(Print &out);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef BRIGHTNESS_H
+#define BRIGHTNESS_H
+
+#include <Arduino.h>
+
+// Ring brightness and oled contrast by the hour of the RTC, so the knob does
+// not light up the bedroom at night. BRIGHTNESS_CURVE is the curve in percent
+// of full, midnight first; define it before this header (or with -D) for
+// another one. It is turned into two PROGMEM tables at compile time: the
+// ring's scale, squared because the eye sees brightness roughly as the
+// square root of the LED current, and the SSD1306 contrast, which is closer
+// to linear. At run time each is a single table lookup.
+//
+// brightness_poll() looks at the hour every BRIGHTNESS_CHECK_MS. The ring
+// gets the new level on the next frame, and the contrast command only goes
+// out when the step actually changes.
+
+#ifndef BRIGHTNESS_CURVE
+#define BRIGHTNESS_CURVE(X) \
+  X(20) X(20) X(20) X(20) X(20) X(20) X(40) X(70) /* 00..07 */ \
+  X(100) X(100) X(100) X(100) X(100) X(100) X(100) X(100) /* 08..15 */ \
+  X(100) X(100) X(100) X(80) X(60) X(45) X(30) X(20) /* 16..23 */
+#endif
+
+#define BRIGHTNESS_CHECK_MS 10000UL
+#define OLED_CONTRAST_FULL 0xCF // what Adafruit_SSD1306::begin() sets
+
+void brightness_poll(); // from loop(), and once in setup() before the first frame
+void brightness_report(Print &out);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Arduino.h>
+
+// -DFRAME_CAPTURE dumps every oled and LED frame over Serial as hex, for
+// tools/frames.py to turn into PPM files / terminal art and compare against
+// golden frames. Meant for the capture env, which replays the sample trace
+// on the virtual clock, so the same firmware gives the same frames every run.
+//
+//   FRAME oled <seq> <draw calls> <pixels drawn> <i2c bytes>
+//   <1024 bytes of SSD1306 buffer, page major>
+//   FRAME led <seq> <lit pixels> <estimated mA>
+//   <RING_PIXELS x GRB as sent>
+//
+// Draw calls and pixels count the drawing primitives since the previous oled
+// frame, see display.h. A partial update (oled_show_rect) still dumps the
+// whole buffer but only its own bytes count towards i2c.
+
+void capture_draw(uint16_t pixels);
+void capture_oled(uint16_t i2c_bytes);
+void capture_led(uint16_t ma);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <Arduino.h>
+#include <RTClib.h>
+
+// Time source for the state machine. Normally this is just millis(), delay()
+// and the DS1307. Built with -DVIRTUAL_CLOCK (the trace replay env turns it on)
+// time only moves when clock_advance() is called, so a recorded session plays
+// back the same way every time and as fast as the loop can spin.
+
+void clock_begin(uint32_t start_unixtime);
+unsigned long clock_millis();
+DateTime clock_now();
+void clock_set(uint32_t unixtime);
+void clock_delay(unsigned long ms);
+void clock_advance(unsigned long ms);
+
+#endif
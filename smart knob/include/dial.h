@@ -0,0 +1,18 @@
+#ifndef DIAL_H
+#define DIAL_H
+
+#include <Arduino.h>
+
+// Progress dial for the running countdowns: an arc that grows clockwise from
+// 12 o'clock as the session elapses, with the time left as mm:ss inside it.
+//
+// The arc comes from a PROGMEM quarter sine table, 256 steps per turn. Each
+// update only draws the steps and digits that changed and flushes just the
+// panel window around them, so a normal second costs a couple of 10x14 digit
+// cells and a few arc pixels on the bus instead of a full 1 KB frame.
+
+// the oled was cleared underneath the dial, draw everything on the next update
+void dial_reset();
+void dial_update(uint32_t left_s, uint32_t total_s);
+
+#endif
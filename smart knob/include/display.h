@@ -0,0 +1,45 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <Adafruit_SSD1306.h>
+#include "capture.h"
+
+// The type of the global `oled`. Normally plain Adafruit_SSD1306; with
+// -DFRAME_CAPTURE it counts every drawing primitive and the pixels it writes,
+// so each captured frame comes with its draw cost.
+
+#ifdef FRAME_CAPTURE
+
+class KnobDisplay : public Adafruit_SSD1306 {
+public:
+  KnobDisplay(uint8_t w, uint8_t h, TwoWire *twi, int8_t rst) : Adafruit_SSD1306(w, h, twi, rst) {}
+
+  // fillRect(), text and lines all end up in these three
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override {
+    capture_draw(1);
+    Adafruit_SSD1306::drawPixel(x, y, color);
+  }
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override {
+    capture_draw(w);
+    Adafruit_SSD1306::drawFastHLine(x, y, w, color);
+  }
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override {
+    capture_draw(h);
+    Adafruit_SSD1306::drawFastVLine(x, y, h, color);
+  }
+  // not virtual, but every caller goes through a KnobDisplay
+  void clearDisplay() {
+    capture_draw(width() * height());
+    Adafruit_SSD1306::clearDisplay();
+  }
+};
+
+#else
+
+typedef Adafruit_SSD1306 KnobDisplay;
+
+#endif
+
+extern KnobDisplay oled;
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef EEPROM_MAP_H
+#define EEPROM_MAP_H
+
+// Who owns which bytes of the 1 KB EEPROM. Every block starts with a magic
+// byte that changes whenever its layout does, so a fresh chip (all 0xFF) or
+// an older layout reads as empty instead of as garbage. New blocks go after
+// the last END.
+
+// weekly schedule, see schedule.h: magic, count, then SCHEDULE_MAX entries
+#define EE_SCHEDULE 0
+#define EE_SCHEDULE_MAGIC 0x51
+#define SCHEDULE_MAX 40
+#define SCHEDULE_ENTRY_SIZE 5
+#define EE_SCHEDULE_END (EE_SCHEDULE + 2 + SCHEDULE_MAX * SCHEDULE_ENTRY_SIZE)
+
+// focus statistics, see stats.h: magic, then one FocusStats
+#define EE_STATS EE_SCHEDULE_END
+#define EE_STATS_MAGIC 0x46
+#define STATS_SIZE 22
+#define EE_STATS_END (EE_STATS + 1 + STATS_SIZE)
+
+// phase program, see program.h: magic, length, CRC-16 (2), then the bytecode
+#define EE_PROGRAM EE_STATS_END
+#define EE_PROGRAM_MAGIC 0x50
+#define PROGRAM_MAX 64
+#define EE_PROGRAM_END (EE_PROGRAM + 4 + PROGRAM_MAX)
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef ENCODER_BENCH_H
+#define ENCODER_BENCH_H
+
+#include <Arduino.h>
+
+// Encoder stress benchmark (-DENCODER_BENCH).
+//
+// Timer1 generates a quadrature signal in hardware on OC1A (D9) and OC1B (D10),
+// so the waveform keeps going while NeoPixel.show() has interrupts off. Unplug
+// the encoder and jumper D9 -> D2 (CLK) and D10 -> D3 (DT). The bench walks the
+// states and step rates below, lets the normal loop() run during each window,
+// and prints expected vs decoded detents per state and rate.
+
+void encoder_bench_begin();
+void encoder_bench_poll(); // top of loop()
+
+#endif
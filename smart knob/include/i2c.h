@@ -0,0 +1,54 @@
+#ifndef I2C_H
+#define I2C_H
+
+#include <Arduino.h>
+
+// The oled and the DS1307 share A4/A5. Every transfer to them is bracketed by
+// i2c_start()/i2c_done(), which bound what a broken bus can cost the loop:
+//
+// - Wire's own timeout (setWireTimeout) ends any single transaction after
+//   I2C_TIMEOUT_US and resets the TWI hardware
+// - a failed transfer clocks SCL until a slave stuck mid-byte lets go of SDA
+//   and sends a STOP (bus clear), so the next one can go out straight away
+// - after I2C_TRIES failures in a row the device backs off, I2C_BACKOFF_MS
+//   doubling up to 64x, and i2c_start() refuses it without touching the bus
+//
+// Callers stop at their first failed transaction instead of running the rest
+// into the same timeout, so one pass of the loop pays a few timeouts at most,
+// whatever the peripheral is doing.
+//
+// -DI2C_FAULTS adds "i2c <oled|rtc> <count>" to the shell: during the
+// device's next count transfers SDA is held low on the bus, so Wire runs
+// into its timeout and the bus clear has a stuck line to free.
+// The TWI can't pull SDA low behind Wire's back (it owns the pins while
+// enabled), so it is switched off for the transfer, see i2c_start().
+
+#define I2C_TIMEOUT_US 2000 // a 31 byte chunk at 400 kHz takes ~0.8 ms
+#define I2C_TRIES 2
+#define I2C_BACKOFF_MS 16
+#define I2C_BAD_DATA 6      // i2c_done() status past Wire's 0..5: read back nonsense
+
+enum I2cDevice : uint8_t {
+  I2C_OLED,
+  I2C_RTC,
+  I2C_DEVICES
+};
+
+struct I2cStats {
+  unsigned long ok;
+  unsigned long errors;   // NACKs, timeouts and bad data
+  unsigned long timeouts;
+  unsigned long skipped;  // refused while backing off
+  unsigned long us_total; // transfers that went out, ok or not
+  unsigned long us_max;
+};
+
+void i2c_begin();                  // before the first transfer, clears a bus left stuck by a reset
+bool i2c_start(uint8_t dev);       // false: backing off, leave the bus alone
+bool i2c_done(uint8_t dev, uint8_t status = 0); // endTransmission()'s status; false if it failed
+bool i2c_recovered(uint8_t dev);   // once, when a device that missed transfers can be used again
+const I2cStats &i2c_stats(uint8_t dev);
+void i2c_inject(uint8_t dev, uint8_t count); // -DI2C_FAULTS only, a no-op otherwise
+void i2c_report(Print &out);
+
+#endif
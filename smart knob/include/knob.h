@@ -0,0 +1,77 @@
+#ifndef KNOB_H
+#define KNOB_H
+
+#include <Arduino.h>
+
+// shared between main.cpp and the helper modules (trace, perf, ...)
+
+//sate machine setup
+enum State {
+  STATE_IDLE,
+  STATE_CONFIG_STUDY,
+  STATE_CONFIG_BREAK,
+  STATE_CONFIG_CYCLE,
+  STATE_CONFIG_TIMER,
+  STATE_STUDY,
+  STATE_BREAK,
+  STATE_TIMER,
+  STATE_MIRROR,   // a PC drives the oled and ring, see mirror.h
+  STATE_PROGRAM   // runs the phase program, see program.h
+};
+
+#define SECONDS_PER_MIN 1 // countdowns tick 1 s per minute for now, see timer_state()
+
+// Everything the encoder ISR and loop() share, one byte per field so any
+// single field reads and writes atomically on the 8-bit core. The ISR bumps
+// knob_seq after each detent it applies. loop() code that needs several
+// fields to agree takes knob_snapshot() instead of reading them one by one.
+// Interrupts stay on while it copies.
+//
+// The main loop can still write single fields directly (the shell, state
+// changes): the ISR can interrupt loop() but not the other way round, so
+// loop() is the only reader that can see a half-applied update.
+struct KnobState {
+  uint8_t state;      // State
+  uint8_t study_time; // minutes
+  uint8_t break_time;
+  uint8_t cycle;      // study sessions per pomodoro
+  uint8_t timer_time;
+  uint8_t clk;        // last encoder CLK level the ISR saw
+  int8_t scrub;       // detents turned while a countdown runs, loop() takes them
+  bool held_turn;     // the ISR navigated with the button down, its release is no press
+  bool paused;        // the running countdown stands still, the ISR doesn't scrub it
+};
+
+extern volatile KnobState knob;
+extern volatile uint8_t knob_seq;
+
+KnobState knob_snapshot();
+
+extern bool pomodoro_mode;
+
+// what the serial shell may change, with the same limits the knob enforces
+struct KnobSetting {
+  char name[6];
+  volatile uint8_t *value;
+  uint8_t min;
+  uint8_t max;
+  uint8_t step;
+};
+
+extern const KnobSetting settings[] PROGMEM;
+extern const uint8_t settings_count;
+
+// one decoded encoder detent. called from the ISR, or from the trace player
+void encoder_step(bool clockwise);
+
+// leave the current state (same reset a long press abort does) and switch
+void enter_state(State next);
+
+// current level of the encoder push button (LOW = pressed)
+bool input_button();
+
+// push the whole oled buffer, or only the part inside the rectangle (inclusive)
+void oled_show();
+void oled_show_rect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <Arduino.h>
+#include <Adafruit_GFX.h>
+
+// Screens as data. A layout is a PROGMEM list of items written with the
+// constexpr helpers below: fixed text, numbers bound to one byte of a model
+// struct, filled rectangles and pips (a row of small squares, the first one
+// filled) and bars. One interpreter draws them all.
+//
+// Every bound item owns a box on the panel. When a model changes but keeps
+// its layout, layout_update() clears and redraws only the boxes of
+// the items whose byte changed and hands back the area to push; the rest
+// of the panel is left alone.
+// Boxes of bound items must not overlap anything else.
+
+enum LayoutOp : uint8_t {
+  LAYOUT_END,
+  LAYOUT_TEXT,   // flash string at the cursor
+  LAYOUT_NUMBER, // the field in decimal
+  LAYOUT_RECT,   // the box, filled
+  LAYOUT_PIPS,   // `field` squares of h x h, h + 2 apart, from the box's top left
+  LAYOUT_BAR,    // a column `field` px high standing on the bottom of the box
+};
+
+#define LAYOUT_STATIC 0xFF // field of items that never change
+#define LAYOUT_PAD2 1      // numbers: at least two digits
+#define LAYOUT_RIGHT 2     // numbers: right aligned to the end of the box
+
+struct LayoutItem {
+  uint8_t op;
+  uint8_t field;        // offset of the model byte the item shows
+  uint8_t x, y, w, h;   // the box
+  uint8_t baseline;     // text cursor y
+  uint8_t size;         // text size
+  uint8_t flags;
+  const GFXfont *font;  // NULL = the built in 5x7
+  const char *text;     // LAYOUT_TEXT only, in flash
+};
+
+constexpr LayoutItem layout_text(const char *text, uint8_t x, uint8_t baseline, const GFXfont *font, uint8_t size) {
+  return LayoutItem{LAYOUT_TEXT, LAYOUT_STATIC, x, 0, 0, 0, baseline, size, 0, font, text};
+}
+
+constexpr LayoutItem layout_number(uint8_t field, uint8_t x, uint8_t y, uint8_t w, uint8_t h, uint8_t baseline,
+                                   const GFXfont *font, uint8_t size, uint8_t flags) {
+  return LayoutItem{LAYOUT_NUMBER, field, x, y, w, h, baseline, size, flags, font, nullptr};
+}
+
+constexpr LayoutItem layout_rect(uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+  return LayoutItem{LAYOUT_RECT, LAYOUT_STATIC, x, y, w, h, 0, 0, 0, nullptr, nullptr};
+}
+
+constexpr LayoutItem layout_pips(uint8_t field, uint8_t x, uint8_t y, uint8_t count, uint8_t h) {
+  return LayoutItem{LAYOUT_PIPS, field, x, y, (uint8_t)(count * (h + 2)), h, 0, 0, 0, nullptr, nullptr};
+}
+
+constexpr LayoutItem layout_bar(uint8_t field, uint8_t x, uint8_t y, uint8_t w, uint8_t h) {
+  return LayoutItem{LAYOUT_BAR, field, x, y, w, h, 0, 0, 0, nullptr, nullptr};
+}
+
+constexpr LayoutItem layout_end() {
+  return LayoutItem{LAYOUT_END, LAYOUT_STATIC, 0, 0, 0, 0, 0, 0, 0, nullptr, nullptr};
+}
+
+struct LayoutBox {
+  uint8_t x0, y0, x1, y1; // inclusive, like oled_show_rect()
+};
+
+// every item into the oled buffer, which the caller cleared and will push
+void layout_draw(const LayoutItem *list, const void *model);
+// only the items whose field differs between the models. dirty gets the box
+// around them for the caller to push; false if nothing was redrawn
+bool layout_update(const LayoutItem *list, const void *model, const void *shown, LayoutBox *dirty);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef MIRROR_H
+#define MIRROR_H
+
+#include <Arduino.h>
+
+// Mirror mode: a PC drives the oled and the ring over the USB serial link
+// (build status, meeting countdowns, ...), see tools/mirror.py. The shell
+// command "mirror [baud]" answers "ok" at the old speed, then switches to
+// the binary protocol. A long press or an exit frame goes back to the clock.
+//
+// Frames are COBS encoded and end with a 0 byte. Decoded, a frame is
+//
+//   'P' page col len data[len]   oled page bytes, SSD1306 buffer layout
+//   'L' runs LedRun[runs]        the whole ring as colour runs, see ring.h
+//   'F'                          end of one host frame, counted for fps
+//   'X'                          leave mirror mode
+//
+// followed by the CRC-16/MCRF4XX of all that, low byte first. Payload bytes
+// are decoded straight into the oled buffer or the ring's run table as they
+// come in, there is no frame buffer. Every frame is answered with
+// MIRROR_ACK once it is on the screen/ring, or MIRROR_NAK if it was broken;
+// the host sends the next one only then, so nothing arrives while the I2C
+// push or the LED write (interrupts off) is running. That is also why the
+// ring is in ring_manual() while mirroring: a soft start steps with the
+// host's 'L' frames, never on its own in between. A broken frame may have
+// left part of its payload in the buffer, the host resends it.
+
+#define MIRROR_BAUD 1000000UL // when "mirror" comes without one
+
+#define MIRROR_ACK 0x06
+#define MIRROR_NAK 0x15
+
+void mirror_begin(unsigned long baud);
+bool mirror_poll(); // false once the host sent 'X'
+void mirror_end(unsigned long baud); // back to the shell at this speed
+void mirror_report(Print &out);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <Arduino.h>
+
+// Loop timing and bus traffic counters. Cheap enough to leave on all the time,
+// the trace player prints them at the end of a replay.
+
+// what one full oled_show() costs on the wire: 1024 data bytes plus the
+// address/control bytes for each 31 byte Wire chunk and the window commands
+#define OLED_FRAME_BYTES 1100
+// per push: address, control byte and the six window commands, one transmission
+#define OLED_RECT_OVERHEAD 8
+// one command through Adafruit_SSD1306::ssd1306_command(): address, 0x00, command
+#define OLED_COMMAND_BYTES 3
+// DS1307 time read: register pointer write + 7 register reads + addressing
+#define RTC_READ_BYTES 10
+
+struct PerfStats {
+  unsigned long loops;
+  unsigned long loop_us_total;
+  unsigned long loop_us_min;
+  unsigned long loop_us_max;
+  unsigned long oled_frames;
+  unsigned long oled_rects;     // partial updates
+  unsigned long oled_transitions;      // slides, see transition.h
+  unsigned long oled_transition_bytes; // their I2C bytes, pages and start line steps
+  unsigned long screens_full;    // show_screen() that cleared and drew everything
+  unsigned long screens_partial; // only the fields that changed, see layout.h
+  unsigned long screen_draw_us;  // drawing into the buffer, I2C not included
+  unsigned long led_frames;
+  unsigned long rtc_reads;
+  unsigned long i2c_bytes;
+  unsigned long led_bytes;
+  unsigned long led_us;         // time spent pushing LED frames
+  unsigned long led_limited;    // frames the power limiter dimmed
+  unsigned long led_runs;       // colour runs sent, the per-frame cost
+  unsigned long led_runs_dropped; // ring_fill() calls that found the run table full
+  uint16_t led_ma_peak;         // highest estimated ring current sent
+  unsigned long encoder_edges;  // encoder ISR entries
+  unsigned long encoder_missed; // ISR saw no level change: the other edge was lost
+  unsigned long encoder_cw;     // decoded detents
+  unsigned long encoder_ccw;
+};
+
+extern PerfStats perf;
+
+void perf_reset();
+void perf_loop_begin();
+void perf_loop_end();
+void perf_oled_frame();
+uint16_t perf_oled_rect(uint16_t bytes); // returns the bytes on the bus
+void perf_oled_command();
+void perf_led_frame(uint16_t bytes);
+void perf_rtc_read();
+void perf_report(Print &out);
+void perf_pin_bench(); // -DPIN_BENCH: digitalRead() vs Pin<N>::read(), knob_snapshot() cycles
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef PIEZO_H
+#define PIEZO_H
+
+#include <Arduino.h>
+
+// Piezo chimes and alarms on D11 (OC2A). Timer2 toggles the pin in hardware
+// (CTC mode, prescaler 64) and its compare ISR counts half periods to step
+// through the melody, so playback never blocks loop(). Not available with
+// -DLED_BACKEND_SPI, which needs D11 as MOSI; D3, the other Timer2 pin, is
+// the encoder.
+//
+// A melody is a PROGMEM byte string, one byte per note: NOTE(pitch, length),
+// ended by PIEZO_END. Pitches go from P_C5 to F#7, lengths from 1/32 s to 1/2 s.
+//
+// piezo_play() only interrupts a melody of the same or lower priority. The
+// button cancels whatever plays (see loop()).
+//
+// -DTONE_BENCH measures the ISR overhead at the highest pitch at boot.
+
+// A5..A7 would clash with the analog pin names
+enum PiezoPitch {
+  P_REST, P_C5, P_Cs5, P_D5, P_Ds5, P_E5, P_F5, P_Fs5, P_G5, P_Gs5, P_A5, P_As5, P_B5,
+  P_C6, P_Cs6, P_D6, P_Ds6, P_E6, P_F6, P_Fs6, P_G6, P_Gs6, P_A6, P_As6, P_B6,
+  P_C7, P_Cs7, P_D7, P_Ds7, P_E7, P_F7, P_Fs7
+};
+
+// length codes, in 1/32 s
+enum PiezoLength { L1, L2, L3, L4, L6, L8, L12, L16 };
+
+#define NOTE(pitch, length) ((pitch) << 3 | (length))
+#define PIEZO_END 0 // a P_REST of L1, the shortest usable rest is L2
+
+enum PiezoPriority {
+  PIEZO_CHIME = 1, // transitions
+  PIEZO_ALARM = 2, // something finished and wants attention
+};
+
+extern const uint8_t melody_study_done[] PROGMEM;
+extern const uint8_t melody_break_done[] PROGMEM;
+extern const uint8_t melody_alarm[] PROGMEM;
+
+void piezo_begin();
+// repeat 0 = until piezo_stop(). false if something more important plays
+bool piezo_play(const uint8_t *melody, uint8_t priority, uint8_t repeat);
+void piezo_stop();
+bool piezo_playing();
+void piezo_bench(); // no-op unless -DTONE_BENCH
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef PINS_H
+#define PINS_H
+
+#include <avr/io.h>
+
+// Compile-time GPIO for the ATmega328 (Nano). Pin<N> works out the port
+// registers, bit and external interrupt of Arduino pin N at compile time, so
+// read()/high()/low() come out as single sbis/sbic/sbi/cbi instructions
+// instead of digitalRead()'s table lookups and checks (~50 cycles each).
+// Asking for a pin the chip doesn't have fails the build.
+
+template <uint8_t N>
+struct Pin {
+  static_assert(N < 20, "Nano pins are 0..19 (A0..A5 = 14..19)");
+
+  static const uint8_t number = N;
+  static const uint8_t mask = 1 << (N < 8 ? N : (N < 14 ? N - 8 : N - 14));
+  static const int8_t interrupt = N == 2 ? 0 : (N == 3 ? 1 : -1); // INT0/INT1
+
+  static inline volatile uint8_t &in() { return N < 8 ? PIND : (N < 14 ? PINB : PINC); }
+  static inline volatile uint8_t &ddr() { return N < 8 ? DDRD : (N < 14 ? DDRB : DDRC); }
+  static inline volatile uint8_t &port() { return N < 8 ? PORTD : (N < 14 ? PORTB : PORTC); }
+
+  static inline bool read() { return (in() & mask) != 0; }
+  static inline void high() { port() |= mask; }
+  static inline void low() { port() &= ~mask; }
+  static inline void toggle() { in() = mask; } // writing PINx flips PORTx
+  static inline void output() { ddr() |= mask; }
+  static inline void input() { ddr() &= ~mask; port() &= ~mask; }
+  static inline void input_pullup() { ddr() &= ~mask; port() |= mask; }
+};
+
+// fire the pin's INTx vector on any edge, the caller defines ISR(INTx_vect)
+template <class P>
+inline void interrupt_on_change() {
+  static_assert(P::interrupt >= 0, "only D2 and D3 have an external interrupt");
+  EICRA = (EICRA & ~(3 << (2 * P::interrupt))) | (1 << (2 * P::interrupt));
+  EIFR = 1 << P::interrupt;
+  EIMSK |= 1 << P::interrupt;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PROGRAM_H
+#define PROGRAM_H
+
+#include <Arduino.h>
+#include "eeprom_map.h"
+
+// User defined phase sequences, e.g. 50/10 three times and a 30 minute long
+// break, or warm-up, intervals and cool-down. "prog" on the shell takes them
+// as text:
+//
+//   prog 5b (50s 10b)x3 30l
+//
+// minutes and a kind per phase (s = study, b = break, l = long break), and
+// one level of brackets repeated x<n> times. The text is compiled to
+// bytecode, two bytes per phase (opcode, minutes), checked, and kept in
+// EEPROM (eeprom_map.h) with a CRC. Repeats are unrolled while compiling, so
+// the interpreter has no loop counters: all it keeps in RAM is the program
+// counter and the deadline of the phase it is in. It reads every phase from
+// EEPROM when it gets there and checks the whole program again before it
+// starts one.
+
+#define PROGRAM_PHASE_MAX 120 // minutes
+
+enum ProgramOp : uint8_t {
+  OP_END,        // never stored, what reading past the end gives
+  OP_STUDY,
+  OP_BREAK,
+  OP_LONG_BREAK,
+};
+
+enum ProgramEvent : uint8_t {
+  PROGRAM_RUNNING,
+  PROGRAM_NEXT,  // the phase ended, the next one has begun
+  PROGRAM_DONE,  // the last phase ended
+};
+
+// program_store() results
+#define PROGRAM_OK 0
+#define PROGRAM_BAD_SYNTAX 1
+#define PROGRAM_TOO_LONG 2
+#define PROGRAM_BAD_PHASE 3 // minutes out of 1..PROGRAM_PHASE_MAX
+
+struct Phase {
+  uint8_t op;
+  uint8_t minutes;
+};
+
+uint8_t program_store(const char *source); // compiles, checks and writes it
+void program_clear();
+bool program_valid();                      // magic, length, CRC and every opcode
+void program_print(Print &out);            // the stored program, unrolled
+
+bool program_start(unsigned long now);     // false if there is no valid program
+void program_stop();
+bool program_running();
+uint8_t program_poll(unsigned long now, bool hold); // hold: paused, the clock stops
+Phase program_phase();                     // the one running
+uint8_t program_index();                   // 0 based
+unsigned long program_left(unsigned long now); // ms of the phase
+
+#endif
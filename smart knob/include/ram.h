@@ -0,0 +1,27 @@
+#ifndef RAM_H
+#define RAM_H
+
+#ifndef __ASSEMBLER__ // ram_paint.S wants STACK_CANARY
+#include <Arduino.h>
+#endif
+
+// SRAM budget on the 2 KB ATmega328. Everything from the end of .bss up to
+// RAMEND is painted with STACK_CANARY before main() runs (ram_paint.S, from
+// .init1), so the bytes the stack has never reached can be counted later
+// (high watermark).
+//
+// tools/ram_budget.py does the static side at build time: per module
+// .data/.bss from the linker map, and fails the build when the free margin
+// drops below custom_ram_margin in platformio.ini.
+
+#define STACK_CANARY 0xC5
+
+#ifndef __ASSEMBLER__
+
+int ram_free();                 // gap between heap top and stack pointer now
+int ram_stack_unused();         // canary bytes the stack never overwrote
+void ram_report(Print &out);
+void ram_poll();                // periodic report with -DRAM_REPORT_MS=...
+#endif
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef RING_H
+#define RING_H
+
+#include <Arduino.h>
+
+// LED ring output. A frame is a short list of colour runs (N pixels of one
+// colour, then M of the next, ...), which is what every mode draws: the time
+// in one or two colours, dark, then the side timer flags. Changing the frame
+// and estimating its current cost per run, not per LED.
+//
+// default          Adafruit_NeoPixel::show() on D5. The runs get expanded into
+//                  NeoPixel's buffer (3 bytes per LED) right before show().
+//                  Bit-banged with interrupts off for the whole frame (~30 us
+//                  per pixel), so encoder edges that arrive meanwhile can be
+//                  lost.
+// -DLED_BACKEND_SPI  expands the runs straight onto the wire out of the
+//                  hardware SPI port, interrupts left on and no pixel buffer
+//                  at all, so -DRING_PIXELS=60/144/300 strips fit in the
+//                  Nano's RAM. DIN has to be wired to D11 (MOSI).
+//
+// Every frame goes through a power limiter first: the current is estimated
+// from the run colours and the ring is dimmed to stay under LED_BUDGET_MA, it
+// shares the Nano's 5 V rail with the OLED and RTC. There is no floor: on a
+// long strip with a low budget a full frame can end up too dim to read, the
+// budget wins over readability. The time-of-day level (ring_dim(), see
+// brightness.h) is folded into the same scale once per frame, so neither
+// costs more than one multiply per run and colour. The dimming is applied
+// while expanding, the runs keep the full colours.
+//
+// -DLED_EDGE_BENCH refreshes the ring continuously and prints encoder edge
+// counts every few seconds, spin the knob to compare the two backends.
+
+#ifndef RING_PIXELS
+#define RING_PIXELS 24
+#endif
+#define RING_PIN 5         // DIN for the show() backend
+#define RING_MAX_RUNS 8    // the busiest mode needs 4
+
+#ifndef LED_BUDGET_MA
+#define LED_BUDGET_MA 500   // what the ring may draw, idle current included
+#endif
+#define LED_MA_PER_CHANNEL 20 // one WS2812 colour at 255
+#define LED_IDLE_MA 1         // per pixel, even when dark
+#define LED_RAMP_MA 100       // how much the draw may rise from one frame to the next
+#define LED_RAMP_MS 10        // resend interval while a soft start is running
+
+struct LedRun {
+  uint16_t end; // one past the last pixel of the run
+  uint8_t r, g, b;
+};
+
+void ring_begin();
+void ring_clear();
+// pixels first .. first+count-1, dropped (and counted in perf) if the frame
+// would need more than RING_MAX_RUNS runs
+void ring_fill(uint16_t first, uint16_t count, uint8_t r, uint8_t g, uint8_t b);
+void ring_set(uint16_t i, uint8_t r, uint8_t g, uint8_t b);
+void ring_show();
+void ring_dim(uint8_t level); // 255 = full, takes effect on the next ring_show()
+void ring_poll(); // call from loop(), finishes soft starts of static frames
+// While on, ring_poll() never resends: the ring goes out with interrupts off,
+// so only the caller may pick the moment, e.g. when it owns the UART and
+// knows nothing is arriving. A soft start then steps once per ring_show().
+void ring_manual(bool on);
+void ring_bench();
+
+// For the mirror mode, which receives whole run tables straight into the
+// ring. Between the two calls ring_fill() and ring_show() leave the table
+// alone. commit checks that the runs cover the ring in order and clears the
+// ring if they don't.
+LedRun *ring_edit();
+bool ring_commit(uint8_t count);
+
+// the frame as it goes out, for frame capture
+uint8_t ring_run_count();
+const LedRun *ring_runs();
+uint8_t ring_scaled(uint8_t v); // after the power limiter
+uint16_t ring_ram();            // runs plus NeoPixel's buffer, if any
+
+#endif
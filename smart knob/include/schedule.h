@@ -0,0 +1,39 @@
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <Arduino.h>
+#include "eeprom_map.h"
+
+// Weekly auto-start table, kept in EEPROM (eeprom_map.h) and sorted by start
+// time. Only the next occurrence lives in RAM, as a unixtime, so the idle
+// screen does a single compare per tick. Edits fix that cache up in place:
+// an added entry only has to beat it, and only removing the cached entry or
+// setting the clock scans the table again.
+
+#define SCHEDULE_DAYS 0x7F  // bit 0 = Sunday, same as DateTime::dayOfTheWeek()
+#define SCHEDULE_TIMER 0x80 // in days: start the timer instead of a pomodoro
+#define SCHEDULE_NONE 0xFFFFFFFFUL
+
+struct ScheduleEntry {
+  uint8_t days;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t work; // study or timer minutes
+  uint8_t rest; // break minutes << 4 | study sessions, pomodoro only
+};
+
+void schedule_begin();                    // checks the EEPROM block, finds the next entry
+uint8_t schedule_count();
+ScheduleEntry schedule_get(uint8_t i);    // sorted by start time
+bool schedule_add(const ScheduleEntry &e); // false when full
+bool schedule_remove(uint8_t i);
+void schedule_clear();
+void schedule_rebuild();                  // after the clock was set
+uint32_t schedule_next_at();              // unixtime, SCHEDULE_NONE if nothing is scheduled
+int schedule_next_index();                // -1 if nothing is scheduled
+
+// the entry to start when its time has come, NULL otherwise. One that was
+// missed by more than a minute (knob busy, power off) is skipped
+const ScheduleEntry *schedule_due(uint32_t now);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SHELL_H
+#define SHELL_H
+
+#include <Arduino.h>
+
+// Line based command shell on Serial (SERIAL_BAUD, \r or \n ends a line).
+// shell_poll() only takes what is already in the receive buffer, so loop()
+// never waits on it. Lines go into one static buffer and the command table
+// lives in flash; longer lines are dropped whole.
+//
+//   help                        list commands
+//   get [study|break|cycle|timer]
+//   set <name> <value>          same limits and steps as the knob
+//   start study|break|timer|pomodoro
+//   stop                        back to the clock
+//   pause                       toggle pause of the running countdown
+//   time [Y M D h m s]          read or set the RTC, any separators
+//   stats                       perf counters, ram, side timers, shell cost
+//   cancel <name>               stop a side timer, T1, T2, ... as stats lists them
+//   sched                       list the weekly schedule and the next start
+//   sched add MTWTF-- 09:00 pomodoro <study> <break> <cycles>
+//   sched add -----SS 10:30 timer <minutes>
+//   sched del <n> | sched clear
+//   mirror [baud]               hand the oled and ring to tools/mirror.py
+
+#define SHELL_LINE_LEN 48 // fits the longest sched add
+
+void shell_poll();
+
+#endif
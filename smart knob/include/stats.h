@@ -0,0 +1,42 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+#include "eeprom_map.h"
+
+// Focus minutes for the idle screen: today, the last STATS_DAYS days and the
+// streak of days in a row with any focus. Nothing is ever added up from a
+// history. Study ticks add to today's bucket and the week total, and a new
+// day moves the ring of buckets on by one and drops the oldest from the
+// total, so every call costs the same however long the knob has been used.
+//
+// Days are unixtime / 86400 of the RTC, which keeps local time, so they
+// roll over at local midnight. The totals live in RAM and go to EEPROM
+// (eeprom_map.h) at the end of a study session and at midnight; a power cut
+// loses at most the session that was running.
+
+#define STATS_DAYS 7
+#define STATS_BAR_FULL 240 // minutes of focus for a full sparkline bar
+
+struct FocusStats {
+  uint16_t day;                  // the day minutes[head] belongs to
+  uint16_t minutes[STATS_DAYS];  // ring of daily focus minutes
+  uint16_t week;                 // sum of minutes[]
+  uint16_t lastFocus;            // the last day with any focus
+  uint8_t head;
+  uint8_t streak;                // days in a row up to lastFocus, 0 once broken
+};
+
+void stats_begin();                        // reads EEPROM, the RTC must be up; no-ops before it
+void stats_day(uint32_t now);              // rollover check, cheap when the day is the same
+void stats_focus(uint32_t now, uint8_t minutes);
+void stats_save();                         // EEPROM, only if something changed
+void stats_clear();
+
+uint16_t stats_today();
+uint16_t stats_week();
+uint8_t stats_streak();
+uint8_t stats_bar(uint8_t daysAgo, uint8_t height); // 0..height px, at least 1 for any focus
+void stats_report(Print &out);
+
+#endif
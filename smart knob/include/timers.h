@@ -0,0 +1,27 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <Arduino.h>
+
+// Side timers (tea, meeting reminder, ...) that run next to whatever the
+// state machine is doing. Kept in a fixed size min-heap on the deadline, so
+// the per-loop expiry check is a single compare against the root and
+// add/cancel are O(log n).
+
+#define MAX_TIMERS 4
+#define TIMER_NAME_LEN 5
+
+struct KnobTimer {
+  unsigned long deadline; // clock_millis() at expiry
+  uint8_t id;             // 1..MAX_TIMERS, 0 = none
+  char name[TIMER_NAME_LEN + 1];
+};
+
+uint8_t timers_add(const char *name, unsigned long deadline); // 0 when full
+bool timers_cancel(uint8_t id);
+const KnobTimer *timers_next();                  // soonest, NULL if none
+const KnobTimer *timers_poll(unsigned long now); // pops one expired timer
+uint8_t timers_count();
+const KnobTimer *timers_get(uint8_t i);          // heap order, 0 = soonest
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+// Input traces: every encoder detent and button edge, with the time since the
+// previous event. One byte per event: 2 bit type + 6 bit delay in 10 ms steps.
+// A delay of 63 means the real delay follows as a little endian uint16 (so a
+// plain TRACE_WAIT can stretch a gap past 655 s). A trace starts with the
+// 4 byte unix time the session was recorded at.
+//
+// -DTRACE_RECORD  dumps the trace over Serial as it happens
+// -DTRACE_REPLAY  plays trace_data[] through the state machine on a virtual
+//                 clock and prints the perf counters when it runs out
+
+#define TRACE_QUANTUM_MS 10
+#define TRACE_EXTENDED 0x3F
+
+#define TRACE_WAIT 0
+#define TRACE_CW 1
+#define TRACE_CCW 2
+#define TRACE_BUTTON 3 // button edge, pressed/released alternate
+
+#ifndef TRACE_STEP_MS
+#define TRACE_STEP_MS 50 // virtual time per loop() during replay
+#endif
+
+#ifndef TRACE_HEADLESS
+#define TRACE_HEADLESS 1 // don't push frames to the oled/ring during replay
+#endif
+
+#if defined(TRACE_REPLAY) && !defined(VIRTUAL_CLOCK)
+#error "TRACE_REPLAY needs VIRTUAL_CLOCK"
+#endif
+
+#if defined(TRACE_REPLAY) && TRACE_HEADLESS
+#define TRACE_SKIP_OUTPUT 1
+#else
+#define TRACE_SKIP_OUTPUT 0
+#endif
+
+void trace_begin();
+bool trace_poll(); // top of loop(), false once a replay has finished
+
+#ifdef TRACE_RECORD
+void trace_record(uint8_t event);
+#else
+inline void trace_record(uint8_t event) {}
+#endif
+
+#ifdef TRACE_REPLAY
+bool trace_button();
+
+extern const uint8_t trace_data[] PROGMEM; // trace_data.cpp
+extern const uint16_t trace_length;
+#endif
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include <Arduino.h>
+
+// Screen changes that slide instead of cut. The SSD1306 display start line
+// register picks which GDDRAM row the panel shows at the top, so stepping it
+// moves the whole picture without sending any pixels. The new screen's
+// pages are written once each, as the start line wraps them from the
+// leaving edge to the entering one (which tears a band of up to 6 rows at
+// the leaving edge, see oled_transition()), and the transition ends back
+// at start line 0 with the new frame in place: 8 page writes plus one 3 byte
+// command per step, where a software slide would resend the full 1 KB frame
+// for every step.
+//
+// The hardware horizontal scroll (0x26/0x27) is no use here: its fastest
+// rate is one column per two panel frames, about two seconds across, and
+// the RAM has to be rewritten after it stops.
+//
+// Blocking, like the ring sweeps: TRANSITION_STEPS * TRANSITION_STEP_MS.
+
+#define TRANSITION_ROWS 2     // start line rows per step
+#define TRANSITION_STEPS (64 / TRANSITION_ROWS)
+#define TRANSITION_STEP_MS 6
+
+enum TransitionDir {
+  SLIDE_UP = 1,   // new screen comes in from the bottom
+  SLIDE_DOWN = -1 // and from the top
+};
+
+// pushes the oled buffer to the panel through the slide
+void oled_transition(TransitionDir dir);
+
+#endif
@@ -0,0 +1,48 @@
+#include "boot.h"
+
+static const char stage_setup[] PROGMEM = "setup entered";
+static const char stage_serial[] PROGMEM = "serial";
+static const char stage_display[] PROGMEM = "display";
+static const char stage_rtc[] PROGMEM = "rtc";
+static const char stage_input[] PROGMEM = "ring/encoder";
+static const char stage_frame[] PROGMEM = "first frame";
+static const char stage_deferred[] PROGMEM = "deferred";
+
+static const char *const stage_names[BOOT_STAGES] PROGMEM = {
+  stage_setup, stage_serial, stage_display, stage_rtc, stage_input, stage_frame, stage_deferred,
+};
+
+static unsigned long stamps[BOOT_STAGES]; // micros() at the end of each stage
+static uint8_t nextTask = 0;
+
+void boot_mark(BootStage stage) {
+  stamps[stage] = micros();
+}
+
+bool boot_poll(void (*const *tasks)(), uint8_t count) {
+  if (nextTask > count) return true;
+  if (nextTask == count) {
+    boot_mark(BOOT_DEFERRED);
+    nextTask++;
+    boot_report(Serial);
+    return true;
+  }
+
+  void (*task)() = (void (*)())pgm_read_ptr(&tasks[nextTask++]);
+  task();
+  return false;
+}
+
+void boot_report(Print &out) {
+  unsigned long last = 0;
+  for (uint8_t i = 0; i < BOOT_STAGES; i++) {
+    if (!stamps[i]) continue; // not reached yet
+    out.print(F("boot "));
+    out.print((const __FlashStringHelper *)pgm_read_ptr(&stage_names[i]));
+    out.print(F(" us: "));
+    out.println(stamps[i] - last);
+    last = stamps[i];
+  }
+  out.print(F("boot first frame at us: "));
+  out.println(stamps[BOOT_FRAME]);
+}
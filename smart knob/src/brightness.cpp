@@ -0,0 +1,55 @@
+#include "brightness.h"
+#include "clock.h"
+#include "display.h"
+#include "ring.h"
+#include "i2c.h"
+#include "perf.h"
+#include "trace.h"
+
+#define LED_SCALE(pct) (uint8_t)((pct) * (pct) * 255UL / 10000),
+#define OLED_CONTRAST(pct) (uint8_t)((pct) * OLED_CONTRAST_FULL / 100),
+
+static const uint8_t led_scale[24] PROGMEM = { BRIGHTNESS_CURVE(LED_SCALE) };
+static const uint8_t oled_contrast[24] PROGMEM = { BRIGHTNESS_CURVE(OLED_CONTRAST) };
+
+static unsigned long lastCheck;
+static bool checked = false;
+static uint8_t hour = 0xFF;
+static uint8_t shownContrast = OLED_CONTRAST_FULL;
+
+// false if the oled did not take it, the next poll tries again
+static bool send_contrast(uint8_t contrast) {
+  perf_oled_command();
+  perf_oled_command();
+  if (TRACE_SKIP_OUTPUT) return true;
+  if (!i2c_start(I2C_OLED)) return false;
+  oled.ssd1306_command(SSD1306_SETCONTRAST);
+  oled.ssd1306_command(contrast);
+  return i2c_done(I2C_OLED);
+}
+
+void brightness_poll() {
+  unsigned long now = clock_millis();
+  if (checked && now - lastCheck < BRIGHTNESS_CHECK_MS) return;
+  lastCheck = now;
+  checked = true;
+
+  uint8_t h = clock_now().hour();
+  if (h != hour) {
+    hour = h;
+    ring_dim(pgm_read_byte(&led_scale[h]));
+    ring_show();
+  }
+
+  uint8_t contrast = pgm_read_byte(&oled_contrast[h]);
+  if (contrast != shownContrast && send_contrast(contrast)) shownContrast = contrast;
+}
+
+void brightness_report(Print &out) {
+  out.print(F("brightness hour/led/contrast: "));
+  out.print(hour);
+  out.print('/');
+  out.print(hour < 24 ? pgm_read_byte(&led_scale[hour]) : 255);
+  out.print('/');
+  out.println(shownContrast);
+}
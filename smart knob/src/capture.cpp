@@ -0,0 +1,79 @@
+#include "display.h"
+#include "capture.h"
+#include "ring.h"
+
+#ifdef FRAME_CAPTURE
+
+static uint16_t oledFrames = 0;
+static uint16_t ledFrames = 0;
+static uint16_t drawCalls = 0;
+static uint32_t drawPixels = 0;
+
+static void hex_dump(const uint8_t *p, uint16_t n, bool newline = true) {
+  static const char digits[] = "0123456789abcdef";
+  while (n--) {
+    Serial.write(digits[*p >> 4]);
+    Serial.write(digits[*p & 15]);
+    p++;
+  }
+  if (newline) Serial.println();
+}
+
+void capture_draw(uint16_t pixels) {
+  drawCalls++;
+  drawPixels += pixels;
+}
+
+void capture_oled(uint16_t i2c_bytes) {
+  Serial.print(F("FRAME oled "));
+  Serial.print(oledFrames++);
+  Serial.print(' ');
+  Serial.print(drawCalls);
+  Serial.print(' ');
+  Serial.print(drawPixels);
+  Serial.print(' ');
+  Serial.println(i2c_bytes);
+  hex_dump(oled.getBuffer(), oled.width() * ((oled.height() + 7) / 8));
+
+  drawCalls = 0;
+  drawPixels = 0;
+}
+
+void capture_led(uint16_t ma) {
+  const LedRun *runs = ring_runs();
+  uint16_t lit = 0;
+  uint16_t start = 0;
+  for (uint8_t k = 0; k < ring_run_count(); k++) {
+    if (runs[k].r | runs[k].g | runs[k].b) lit += runs[k].end - start;
+    start = runs[k].end;
+  }
+
+  Serial.print(F("FRAME led "));
+  Serial.print(ledFrames++);
+  Serial.print(' ');
+  Serial.print(lit);
+  Serial.print(' ');
+  Serial.println(ma);
+
+  // expanded the way the backends do it, there is no pixel buffer to dump
+  start = 0;
+  for (uint8_t k = 0; k < ring_run_count(); k++) {
+    uint8_t grb[3] = {ring_scaled(runs[k].g), ring_scaled(runs[k].r), ring_scaled(runs[k].b)};
+    for (uint16_t n = runs[k].end - start; n; n--) hex_dump(grb, 3, false);
+    start = runs[k].end;
+  }
+  Serial.println();
+}
+
+#else
+
+void capture_draw(uint16_t pixels) {
+}
+
+void capture_oled(uint16_t i2c_bytes) {
+}
+
+void capture_led(uint16_t ma) {
+}
+
+#endif
@@ -0,0 +1,79 @@
+#include "clock.h"
+#include "perf.h"
+#include "i2c.h"
+
+extern RTC_DS1307 rtc;
+
+#ifdef VIRTUAL_CLOCK
+
+static unsigned long virtual_ms = 0;
+static uint32_t virtual_start = 0;
+
+void clock_begin(uint32_t start_unixtime) {
+  virtual_start = start_unixtime;
+  virtual_ms = 0;
+}
+
+unsigned long clock_millis() {
+  return virtual_ms;
+}
+
+DateTime clock_now() {
+  perf_rtc_read();
+  return DateTime(virtual_start + virtual_ms / 1000);
+}
+
+void clock_set(uint32_t unixtime) {
+  virtual_start = unixtime - virtual_ms / 1000;
+}
+
+void clock_delay(unsigned long ms) {
+  virtual_ms += ms; // animations cost no real time during replay
+}
+
+void clock_advance(unsigned long ms) {
+  virtual_ms += ms;
+}
+
+#else
+
+void clock_begin(uint32_t start_unixtime) {
+  // real time comes from the DS1307, nothing to set up
+}
+
+unsigned long clock_millis() {
+  return millis();
+}
+
+// a read that times out or comes back out of range is retried once (see
+// i2c.h), after that the time counts on from the last good one
+DateTime clock_now() {
+  static DateTime last;
+  static unsigned long lastMs = 0;
+
+  perf_rtc_read();
+  for (uint8_t i = 0; i < I2C_TRIES && i2c_start(I2C_RTC); i++) {
+    DateTime now = rtc.now();
+    if (i2c_done(I2C_RTC, now.isValid() ? 0 : I2C_BAD_DATA)) {
+      last = now;
+      lastMs = millis();
+      return now;
+    }
+  }
+  return DateTime(last.unixtime() + (millis() - lastMs) / 1000);
+}
+
+void clock_set(uint32_t unixtime) {
+  if (!i2c_start(I2C_RTC)) return;
+  rtc.adjust(DateTime(unixtime));
+  i2c_done(I2C_RTC);
+}
+
+void clock_delay(unsigned long ms) {
+  delay(ms);
+}
+
+void clock_advance(unsigned long ms) {
+}
+
+#endif
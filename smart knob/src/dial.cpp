@@ -0,0 +1,144 @@
+#include "display.h"
+#include "dial.h"
+#include "knob.h"
+
+#define DIAL_X 64
+#define DIAL_Y 32
+#define DIAL_R_IN 28
+#define DIAL_R_OUT 31
+#define DIAL_STEPS 256
+
+#define DIGIT_W 10 // size 2 glyph without the spacing column
+#define DIGIT_H 14
+#define DIGIT_Y (DIAL_Y - DIGIT_H / 2)
+#define COLON_W 6
+#define COLON_CELL 5
+
+// 255 * sin(i * 90 / 64 deg)
+static const uint8_t quarter_sine[65] PROGMEM = {
+  0, 6, 13, 19, 25, 31, 37, 44, 50, 56, 62, 68, 74, 80, 86, 92,
+  98, 103, 109, 115, 120, 126, 131, 136, 142, 147, 152, 157, 162, 167, 171, 176,
+  180, 185, 189, 193, 197, 201, 205, 208, 212, 215, 219, 222, 225, 228, 231, 233,
+  236, 238, 240, 242, 244, 246, 247, 249, 250, 251, 252, 253, 254, 254, 255, 255,
+  255
+};
+
+static uint16_t shownArc = 0;   // arc steps on the panel
+static char shownDigits[6];     // mm(m) ss cells and the colon, 0 = not drawn yet
+static uint8_t minuteDigits = 0; // 2 or 3, from the session's length
+static bool dirty = false;
+static uint8_t dirtyX0, dirtyY0, dirtyX1, dirtyY1;
+
+// a full turn is 256, 0 = 12 o'clock
+static int16_t dial_sin(uint8_t a) {
+  uint8_t i = a & 63;
+  if (a & 64) i = 64 - i;
+  int16_t s = pgm_read_byte(&quarter_sine[i]);
+  return (a & 128) ? -s : s;
+}
+
+static void mark(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1) {
+  if (!dirty) {
+    dirtyX0 = x0; dirtyY0 = y0; dirtyX1 = x1; dirtyY1 = y1;
+    dirty = true;
+    return;
+  }
+  if (x0 < dirtyX0) dirtyX0 = x0;
+  if (y0 < dirtyY0) dirtyY0 = y0;
+  if (x1 > dirtyX1) dirtyX1 = x1;
+  if (y1 > dirtyY1) dirtyY1 = y1;
+}
+
+// one radial spoke of the arc
+static void draw_step(uint8_t a, uint16_t color) {
+  int16_t s = dial_sin(a);
+  int16_t c = dial_sin(a + 64);
+
+  for (uint8_t r = DIAL_R_IN; r <= DIAL_R_OUT; r++) {
+    uint8_t x = DIAL_X + ((r * s + 128) >> 8);
+    uint8_t y = DIAL_Y - ((r * c + 128) >> 8);
+    oled.drawPixel(x, y, color);
+    mark(x, y, x, y);
+  }
+}
+
+static void draw_arc(uint16_t steps) {
+  if (steps > shownArc) {
+    for (uint16_t a = shownArc; a < steps; a++) draw_step(a, SSD1306_WHITE);
+  }
+  else if (steps < shownArc) {
+    for (uint16_t a = steps; a < shownArc; a++) draw_step(a, SSD1306_BLACK);
+    if (steps > 0) draw_step(steps - 1, SSD1306_WHITE); // neighbours share pixels
+  }
+  shownArc = steps;
+}
+
+static void draw_digit(uint8_t cell, uint8_t x, char c) {
+  if (shownDigits[cell] == c) return;
+  shownDigits[cell] = c;
+  oled.fillRect(x, DIGIT_Y, DIGIT_W, DIGIT_H, SSD1306_BLACK);
+  oled.drawChar(x, DIGIT_Y, c, SSD1306_WHITE, SSD1306_WHITE, 2); // bg == fg: no spacing column
+  mark(x, DIGIT_Y, x + DIGIT_W - 1, DIGIT_Y + DIGIT_H - 1);
+}
+
+static void draw_readout(uint32_t left_s) {
+  // 3 minute digits would not fit inside the arc at the normal pitch
+  uint8_t pitch = minuteDigits == 3 ? DIGIT_W : DIGIT_W + 1;
+  uint8_t width = (minuteDigits + 2) * pitch + COLON_W;
+  uint8_t x = DIAL_X - width / 2;
+  uint16_t minutes = left_s / 60;
+  uint8_t seconds = left_s % 60;
+  char text[6];
+
+  oled.setFont(); // classic 5x7 font, drawChar() takes y as the top of the cell
+
+  if (minuteDigits == 3) sprintf(text, "%03u%02u", minutes, seconds);
+  else sprintf(text, "%02u%02u", minutes, seconds);
+
+  for (uint8_t i = 0; i < minuteDigits; i++, x += pitch) draw_digit(i, x, text[i]);
+
+  if (!shownDigits[COLON_CELL]) { // colon, drawn once per session
+    oled.fillRect(x + 1, DIAL_Y - 4, 2, 2, SSD1306_WHITE);
+    oled.fillRect(x + 1, DIAL_Y + 2, 2, 2, SSD1306_WHITE);
+    mark(x + 1, DIAL_Y - 4, x + 2, DIAL_Y + 3);
+    shownDigits[COLON_CELL] = ':';
+  }
+  x += COLON_W;
+
+  for (uint8_t i = 0; i < 2; i++, x += pitch) draw_digit(minuteDigits + i, x, text[minuteDigits + i]);
+}
+
+void dial_reset() {
+  shownArc = 0;
+  memset(shownDigits, 0, sizeof(shownDigits));
+  minuteDigits = 0;
+  dirty = false;
+}
+
+// the session was scrubbed across 100 minutes: the readout moves, so its
+// cells and the colon start over. The wider layout covers the narrower one
+static void relayout(uint8_t digits) {
+  if (minuteDigits) {
+    uint8_t width = 5 * DIGIT_W + COLON_W;
+    uint8_t x = DIAL_X - width / 2;
+    oled.fillRect(x, DIGIT_Y, width, DIGIT_H, SSD1306_BLACK);
+    mark(x, DIGIT_Y, x + width - 1, DIGIT_Y + DIGIT_H - 1);
+    memset(shownDigits, 0, sizeof(shownDigits));
+  }
+  minuteDigits = digits;
+}
+
+void dial_update(uint32_t left_s, uint32_t total_s) {
+  if (total_s == 0) return;
+  if (left_s > total_s) left_s = total_s;
+
+  uint8_t digits = total_s >= 6000 ? 3 : 2;
+  if (digits != minuteDigits) relayout(digits);
+
+  draw_arc((uint32_t)(total_s - left_s) * DIAL_STEPS / total_s);
+  draw_readout(left_s);
+
+  if (!dirty) return;
+  oled_show_rect(dirtyX0, dirtyY0, dirtyX1, dirtyY1);
+  dirty = false;
+}
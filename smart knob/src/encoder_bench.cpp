@@ -0,0 +1,140 @@
+#include "encoder_bench.h"
+#include "knob.h"
+#include "perf.h"
+#include "pins.h"
+
+#ifdef ENCODER_BENCH
+
+#ifdef LED_BACKEND_SPI
+#error "the bench uses D10 (OC1B), which the SPI LED backend needs as SS"
+#endif
+
+typedef Pin<9> BenchClk; // OC1A
+typedef Pin<10> BenchDt; // OC1B
+
+#define BENCH_WINDOW_MS 2000
+
+static const uint8_t benchStates[] = {STATE_IDLE, STATE_CONFIG_STUDY, STATE_CONFIG_TIMER, STATE_STUDY, STATE_TIMER};
+static const uint16_t benchRates[] = {25, 50, 100, 200, 400, 800, 1600, 3200}; // detents per second
+
+static uint8_t stateIndex = 0;
+static uint8_t rateIndex = 0;
+static bool clockwise = true;
+static bool running = false;
+static bool finished = false;
+static unsigned long windowStart = 0;
+static unsigned long cwStart = 0;
+static unsigned long ccwStart = 0;
+
+// Timer1 in CTC mode at 2 MHz. OC1A (CLK) toggles at TOP, OC1B (DT) half way
+// there, so DT is 90 degrees off CLK and one detent is two compare periods.
+static void generator_start(uint16_t rate, bool cw) {
+  TCCR1B = 0;
+  TCCR1A = 0;
+  TCNT1 = 0;
+  OCR1A = 1000000UL / rate - 1;
+  OCR1B = OCR1A / 2;
+
+  // force the start levels: CLK low, DT high for clockwise / low for ccw.
+  // DT then flips before each CLK edge, so it reads high on CLK falling for cw
+  TCCR1A = _BV(COM1A1) | _BV(COM1B1);  // clear on match
+  TCCR1C = _BV(FOC1A) | _BV(FOC1B);
+  if (cw) {
+    TCCR1A = _BV(COM1A1) | _BV(COM1B1) | _BV(COM1B0); // set OC1B
+    TCCR1C = _BV(FOC1B);
+  }
+  BenchClk::output();
+  BenchDt::output();
+
+  TCCR1A = _BV(COM1A0) | _BV(COM1B0); // toggle both on match
+  TCCR1B = _BV(WGM12) | _BV(CS11);    // CTC on OCR1A, clk/8
+}
+
+static void generator_stop() {
+  TCCR1B = 0;
+  TCCR1A = 0; // pins keep driving their last level until the next window
+}
+
+static void print_percent(unsigned long part, unsigned long whole) {
+  unsigned long tenths = whole ? part * 1000 / whole : 0;
+  Serial.print(tenths / 10);
+  Serial.print('.');
+  Serial.print(tenths % 10);
+  Serial.print('%');
+}
+
+static void bench_report(unsigned long elapsedUs) {
+  uint16_t rate = benchRates[rateIndex];
+  unsigned long expected = elapsedUs / (1000000UL / rate); // one detent = OCR1A + 1 us
+  unsigned long right = clockwise ? perf.encoder_cw - cwStart : perf.encoder_ccw - ccwStart;
+  unsigned long wrong = clockwise ? perf.encoder_ccw - ccwStart : perf.encoder_cw - cwStart;
+  unsigned long lost = expected > right + wrong ? expected - right - wrong : 0;
+
+  Serial.print(F("bench state="));
+  Serial.print(benchStates[stateIndex]);
+  Serial.print(F(" rate="));
+  Serial.print(rate);
+  Serial.print(clockwise ? F(" cw") : F(" ccw"));
+  Serial.print(F(" expected="));
+  Serial.print(expected);
+  Serial.print(F(" decoded="));
+  Serial.print(right);
+  Serial.print(F(" misdir="));
+  Serial.print(wrong);
+  Serial.print(F(" lost="));
+  print_percent(lost, expected);
+  Serial.print(F(" misdir="));
+  print_percent(wrong, expected);
+  Serial.println();
+}
+
+static void window_start() {
+  enter_state((State)benchStates[stateIndex]);
+  cwStart = perf.encoder_cw;
+  ccwStart = perf.encoder_ccw;
+  generator_start(benchRates[rateIndex], clockwise);
+  windowStart = micros();
+  running = true;
+}
+
+void encoder_bench_begin() {
+  Serial.println(F("encoder bench: D9->D2, D10->D3, encoder unplugged"));
+  window_start();
+}
+
+void encoder_bench_poll() {
+  if (finished || !running) return;
+  if (micros() - windowStart < BENCH_WINDOW_MS * 1000UL) return;
+
+  generator_stop();
+  unsigned long elapsed = micros() - windowStart;
+  running = false;
+  bench_report(elapsed);
+
+  // next direction, then next rate, then next state
+  if (clockwise) {
+    clockwise = false;
+  } else {
+    clockwise = true;
+    if (++rateIndex == sizeof(benchRates) / sizeof(benchRates[0])) {
+      rateIndex = 0;
+      if (++stateIndex == sizeof(benchStates)) {
+        finished = true;
+        enter_state(STATE_IDLE);
+        Serial.println(F("encoder bench done"));
+        return;
+      }
+    }
+  }
+  window_start();
+}
+
+#else
+
+void encoder_bench_begin() {
+}
+
+void encoder_bench_poll() {
+}
+
+#endif
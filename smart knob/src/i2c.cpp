@@ -0,0 +1,179 @@
+#include "i2c.h"
+#include <Wire.h>
+#include <avr/power.h>
+#include "pins.h"
+
+typedef Pin<18> Sda; // A4
+typedef Pin<19> Scl; // A5
+
+struct I2cLink {
+  unsigned long since;   // millis() the backoff started
+  uint16_t backoff;      // ms, 0 = none
+  uint8_t fails;         // in a row
+  uint8_t faults;        // -DI2C_FAULTS: transfers left to fail
+  bool lost;             // something was skipped or failed since the last i2c_recovered()
+};
+
+static I2cLink links[I2C_DEVICES];
+static I2cStats stats[I2C_DEVICES];
+static unsigned long busClears = 0;
+static unsigned long busStuck = 0; // clears that left SDA or SCL low
+static unsigned long started;
+static bool holding = false; // -DI2C_FAULTS: SDA is driven low for this transfer
+
+static void half_clock() {
+  delayMicroseconds(5); // 100 kHz
+}
+
+// Wire off, then bit-bang the pins as open drain: low() + output() pulls the
+// line down, input_pullup() lets it go. Up to 9 clocks finish whatever byte
+// a slave was sending, then SDA rising while SCL is high is a STOP
+static void bus_clear() {
+  busClears++;
+  Wire.end();
+  Sda::input_pullup();
+  Scl::input_pullup();
+  half_clock();
+
+  for (uint8_t i = 0; i < 9 && !Sda::read(); i++) {
+    Scl::low();
+    Scl::output();
+    half_clock();
+    Scl::input_pullup();
+    half_clock();
+  }
+  Sda::low();
+  Sda::output();
+  half_clock();
+  Scl::input_pullup();
+  half_clock();
+  Sda::input_pullup();
+  half_clock();
+  if (!Sda::read() || !Scl::read()) busStuck++; // the next transfer will time out again
+
+  Wire.begin();
+  Wire.setWireTimeout(I2C_TIMEOUT_US, true);
+}
+
+void i2c_begin() {
+  Sda::input_pullup();
+  Scl::input_pullup();
+  if (!Sda::read()) bus_clear();
+  Wire.setWireTimeout(I2C_TIMEOUT_US, true);
+}
+
+static bool backing_off(I2cLink &link) {
+  if (link.backoff && millis() - link.since >= link.backoff) link.backoff = 0;
+  return link.backoff != 0;
+}
+
+bool i2c_start(uint8_t dev) {
+  if (backing_off(links[dev])) {
+    stats[dev].skipped++;
+    links[dev].lost = true;
+    return false;
+  }
+  Wire.clearWireTimeoutFlag();
+
+#ifdef I2C_FAULTS
+  // a slave holding SDA, for real: the TWI lets go of the pins and SDA is
+  // pulled low on the bus. With its clock stopped the TWI ignores Wire's
+  // START, so Wire waits out its own timeout. Without the reset on timeout,
+  // twi_init() would set the PORT bit and drive SDA high against the hold;
+  // i2c_done() lets go of it
+  if (links[dev].faults) {
+    links[dev].faults--;
+    holding = true;
+    Wire.end();
+    Wire.setWireTimeout(I2C_TIMEOUT_US, false);
+    Sda::low();
+    Sda::output();
+    power_twi_disable();
+  }
+#endif
+
+  started = micros();
+  return true;
+}
+
+bool i2c_done(uint8_t dev, uint8_t status) {
+  I2cLink &link = links[dev];
+  I2cStats &s = stats[dev];
+  bool timeout = Wire.getWireTimeoutFlag();
+#ifdef I2C_FAULTS
+  if (holding) { // SDA back to an input first, only then the TWI gets the pins
+    holding = false;
+    Sda::input();
+    power_twi_enable();
+    Wire.begin();
+    Wire.setWireTimeout(I2C_TIMEOUT_US, true);
+  }
+#endif
+
+  unsigned long us = micros() - started;
+  s.us_total += us;
+  if (us > s.us_max) s.us_max = us;
+
+  if (status == 0 && !timeout) {
+    s.ok++;
+    link.fails = 0;
+    return true;
+  }
+
+  s.errors++;
+  if (timeout) s.timeouts++;
+  link.lost = true;
+  bus_clear();
+
+  if (link.fails < 255) link.fails++;
+  if (link.fails >= I2C_TRIES) {
+    uint8_t shift = link.fails - I2C_TRIES;
+    link.backoff = I2C_BACKOFF_MS << (shift < 6 ? shift : 6);
+    link.since = millis();
+  }
+  return false;
+}
+
+bool i2c_recovered(uint8_t dev) {
+  I2cLink &link = links[dev];
+  if (!link.lost || backing_off(link)) return false;
+  link.lost = false;
+  return true;
+}
+
+const I2cStats &i2c_stats(uint8_t dev) {
+  return stats[dev];
+}
+
+void i2c_inject(uint8_t dev, uint8_t count) {
+#ifdef I2C_FAULTS
+  links[dev].faults = count;
+#endif
+}
+
+void i2c_report(Print &out) {
+  static const char names[I2C_DEVICES][5] PROGMEM = {"oled", "rtc"};
+
+  for (uint8_t dev = 0; dev < I2C_DEVICES; dev++) {
+    const I2cStats &s = stats[dev];
+    unsigned long tried = s.ok + s.errors;
+    out.print(F("i2c "));
+    out.print((const __FlashStringHelper *)names[dev]);
+    out.print(F(" ok/errors/timeouts/skipped: "));
+    out.print(s.ok);
+    out.print('/');
+    out.print(s.errors);
+    out.print('/');
+    out.print(s.timeouts);
+    out.print('/');
+    out.print(s.skipped);
+    out.print(F(", us avg/max: "));
+    out.print(tried ? s.us_total / tried : 0);
+    out.print('/');
+    out.println(s.us_max);
+  }
+  out.print(F("i2c bus clears/stuck: "));
+  out.print(busClears);
+  out.print('/');
+  out.println(busStuck);
+}
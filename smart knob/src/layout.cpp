@@ -0,0 +1,88 @@
+#include "layout.h"
+#include "display.h"
+
+// advance of a RAM string, what the cursor moves while printing it
+static uint8_t text_width(const GFXfont *font, uint8_t size, const char *s) {
+  if (!font) return strlen(s) * 6 * size;
+
+  const GFXglyph *glyphs = (const GFXglyph *)pgm_read_ptr(&font->glyph);
+  uint8_t first = pgm_read_word(&font->first);
+  uint8_t w = 0;
+  for (; *s; s++) w += pgm_read_byte(&glyphs[*s - first].xAdvance) * size;
+  return w;
+}
+
+static void draw_item(const LayoutItem &it, const uint8_t *model) {
+  uint8_t value = it.field == LAYOUT_STATIC ? 0 : model[it.field];
+
+  switch (it.op) {
+    case LAYOUT_RECT:
+      oled.fillRect(it.x, it.y, it.w, it.h, SSD1306_WHITE);
+      break;
+
+    case LAYOUT_PIPS:
+      for (uint8_t i = 0; i < value && (i + 1) * (it.h + 2) <= it.w; i++) {
+        if (i == 0) oled.fillRect(it.x, it.y, it.h, it.h, SSD1306_WHITE);
+        else oled.drawRect(it.x + i * (it.h + 2), it.y, it.h, it.h, SSD1306_WHITE);
+      }
+      break;
+
+    case LAYOUT_BAR:
+      if (value > it.h) value = it.h;
+      if (value) oled.fillRect(it.x, it.y + it.h - value, it.w, value, SSD1306_WHITE);
+      break;
+
+    case LAYOUT_TEXT:
+    case LAYOUT_NUMBER: {
+      oled.setFont(it.font);
+      oled.setTextSize(it.size);
+      oled.setTextColor(SSD1306_WHITE);
+      if (it.op == LAYOUT_TEXT) {
+        oled.setCursor(it.x, it.baseline);
+        oled.print((const __FlashStringHelper *)it.text);
+        break;
+      }
+
+      char digits[4];
+      sprintf(digits, it.flags & LAYOUT_PAD2 ? "%02u" : "%u", value);
+      uint8_t x = it.x;
+      if (it.flags & LAYOUT_RIGHT) x += it.w - text_width(it.font, it.size, digits);
+      oled.setCursor(x, it.baseline);
+      oled.print(digits);
+      break;
+    }
+  }
+}
+
+void layout_draw(const LayoutItem *list, const void *model) {
+  LayoutItem it;
+  for (memcpy_P(&it, list, sizeof(it)); it.op != LAYOUT_END; memcpy_P(&it, ++list, sizeof(it))) {
+    draw_item(it, (const uint8_t *)model);
+  }
+}
+
+bool layout_update(const LayoutItem *list, const void *model, const void *shown, LayoutBox *dirty) {
+  const uint8_t *now = (const uint8_t *)model;
+  const uint8_t *was = (const uint8_t *)shown;
+  bool redrawn = false;
+
+  LayoutItem it;
+  for (memcpy_P(&it, list, sizeof(it)); it.op != LAYOUT_END; memcpy_P(&it, ++list, sizeof(it))) {
+    if (it.field == LAYOUT_STATIC || now[it.field] == was[it.field]) continue;
+
+    oled.fillRect(it.x, it.y, it.w, it.h, SSD1306_BLACK);
+    draw_item(it, now);
+
+    uint8_t x1 = it.x + it.w - 1 < oled.width() ? it.x + it.w - 1 : oled.width() - 1;
+    uint8_t y1 = it.y + it.h - 1;
+    if (!redrawn) *dirty = LayoutBox{it.x, it.y, x1, y1};
+    else {
+      if (it.x < dirty->x0) dirty->x0 = it.x;
+      if (it.y < dirty->y0) dirty->y0 = it.y;
+      if (x1 > dirty->x1) dirty->x1 = x1;
+      if (y1 > dirty->y1) dirty->y1 = y1;
+    }
+    redrawn = true;
+  }
+  return redrawn;
+}
@@ -1,30 +1,39 @@
 #include <Arduino.h>
-#include <Adafruit_NeoPixel.h> //for neopixel
 #include <Adafruit_GFX.h> //for oled module
 #include <Adafruit_SSD1306.h> //for oled module
+#include "display.h"
 #include <Wire.h> //this is for I2C. SPI.h for SPI'
 #include <RTClib.h>
 #include <Encoder.h>
 #include <Fonts/Picopixel.h>
 #include <Fonts/Org_01.h>
+#include "knob.h"
+#include "clock.h"
+#include "perf.h"
+#include "trace.h"
+#include "ring.h"
+#include "timers.h"
+#include "encoder_bench.h"
+#include "pins.h"
+#include "ram.h"
+#include "dial.h"
+#include "shell.h"
+#include "capture.h"
+#include "boot.h"
+#include "piezo.h"
+#include "schedule.h"
+#include "mirror.h"
+#include "transition.h"
+#include "layout.h"
+#include "stats.h"
+#include "i2c.h"
+#include "program.h"
+#include "brightness.h"
 
-//sate machine setup
-enum State {
-  STATE_IDLE,
-  STATE_CONFIG_STUDY,
-  STATE_CONFIG_BREAK,
-  STATE_CONFIG_CYCLE,
-  STATE_CONFIG_TIMER,
-  STATE_STUDY,
-  STATE_BREAK,
-  STATE_TIMER
-};
-
-State currentState = STATE_IDLE;
 
 //neopixel definitions
-#define PIN_NEO_PIXEL 5  // Arduino pin that connects to NeoPixel
-#define NUM_PIXELS 24    // The number of LEDs (pixels) on NeoPixel
+#define PIN_NEO_PIXEL RING_PIN  // Arduino pin that connects to NeoPixel
+#define NUM_PIXELS RING_PIXELS  // The number of LEDs (pixels) on NeoPixel, -DRING_PIXELS for longer strips
 #define STUDY_PIXELS_PER_MINS 5 // number of mins which acts as one pixel in NeoPixel
 #define BREAK_PIXELS_PER_MINS 1
 #define CYCLE_PIXELS_PER_MINS 1
@@ -45,24 +54,56 @@ State currentState = STATE_IDLE;
 #define CYCLE_ADDITIONAL_TIME 220, 100, 255
 #define TIMER_MIN_COLOR 255, 0, 0
 #define TIMER_ADDITIONAL_TIME 255, 38, 38
+#define TIMER_FLAG_COLOR 40, 40, 40 // one pixel per side timer while something else runs
+#ifndef SERIAL_BAUD
+#define SERIAL_BAUD 9600
+#endif
 
 
-Adafruit_NeoPixel NeoPixel(NUM_PIXELS, PIN_NEO_PIXEL, NEO_GRB + NEO_KHZ800); //neopixel instance
 #define LIGHT_DELAY 50
+#define SWEEP_STEPS 24 // the completion sweep, steps whatever the ring length
+
+volatile KnobState knob = {STATE_IDLE, MIN_STUDY_TIME, MIN_BREAK_TIME, MIN_CYCLE_TIME, MIN_TIMER_TIME, HIGH, 0};
+volatile uint8_t knob_seq = 0;
+
+static_assert(MAX_STUDY_TIME <= 255 && MAX_BREAK_TIME <= 255 && MAX_CYCLE_TIME <= 255 && MAX_TIMER_TIME <= 255,
+              "settings live in uint8_t fields");
+
+// retries if a detent landed while copying, which is rare and takes one ISR
+KnobState knob_snapshot(){
+  KnobState copy;
+  uint8_t seq;
+  do {
+    seq = knob_seq;
+    copy.state = knob.state;
+    copy.study_time = knob.study_time;
+    copy.break_time = knob.break_time;
+    copy.cycle = knob.cycle;
+    copy.timer_time = knob.timer_time;
+    copy.clk = knob.clk;
+    copy.scrub = knob.scrub;
+    copy.held_turn = knob.held_turn;
+    copy.paused = knob.paused;
+  } while (seq != knob_seq);
+  return copy;
+}
 
-volatile int study_time = MIN_STUDY_TIME; //will be in minutes. Need to take input from user. 
-volatile int break_time = MIN_BREAK_TIME;
-volatile int cycle = MIN_CYCLE_TIME;
-volatile int timer_time = MIN_TIMER_TIME;
-
-bool paused = false;
 bool pomodoro_mode=false;
 
+const KnobSetting settings[] PROGMEM = {
+  {"study", &knob.study_time, MIN_STUDY_TIME, MAX_STUDY_TIME, STUDY_PIXELS_PER_MINS},
+  {"break", &knob.break_time, MIN_BREAK_TIME, MAX_BREAK_TIME, BREAK_PIXELS_PER_MINS},
+  {"cycle", &knob.cycle, MIN_CYCLE_TIME, MAX_CYCLE_TIME, CYCLE_PIXELS_PER_MINS},
+  {"timer", &knob.timer_time, MIN_TIMER_TIME, MAX_TIMER_TIME, TIMER_PIXELS_PER_MINS},
+};
+const uint8_t settings_count = sizeof(settings) / sizeof(settings[0]);
+
 //oled module definitions
 #define SCREEN_WIDTH 128
 #define SCREEN_HEIGHT 64
+#define OLED_ADDRESS 0x3c
 
-Adafruit_SSD1306 oled(SCREEN_WIDTH,SCREEN_HEIGHT,&Wire,-1); //oled module instance
+KnobDisplay oled(SCREEN_WIDTH,SCREEN_HEIGHT,&Wire,-1); //oled module instance, see display.h
 
 #define FRAME_DELAY (0)
 #define FRAME_WIDTH (48)
@@ -75,10 +116,18 @@ RTC_DS1307 rtc;
 #define ENCODER_DT  3 //for encoder DT pin
 #define ENCODER_BUTTON 4 // for encoder SW pin
 
+typedef Pin<ENCODER_CLK> EncoderClk;
+typedef Pin<ENCODER_DT> EncoderDt;
+typedef Pin<ENCODER_BUTTON> EncoderButton;
+
+static_assert(EncoderClk::interrupt >= 0, "ENCODER_CLK needs an external interrupt pin (D2 or D3)");
+static_assert(ENCODER_CLK != ENCODER_DT && ENCODER_CLK != ENCODER_BUTTON && ENCODER_DT != ENCODER_BUTTON &&
+              PIN_NEO_PIXEL != ENCODER_CLK && PIN_NEO_PIXEL != ENCODER_DT && PIN_NEO_PIXEL != ENCODER_BUTTON,
+              "two things wired to the same pin");
+static_assert(ENCODER_CLK > 1 && ENCODER_DT > 1 && ENCODER_BUTTON > 1 && PIN_NEO_PIXEL > 1, "D0/D1 are the Serial link");
+
 
 
-volatile int CLKstate;
-volatile int lastCLKstate;
 
 // returns: 0 = no event, 1 = short press, 2 = long press
 
@@ -89,14 +138,100 @@ void config_timer_state(bool reset=false);
 void study_state(bool reset=false);
 void break_state(bool reset=false);
 void timer_state(bool reset=false);
+void program_state(bool reset=false);
+
+
+// The window (all six commands in one transmission), then the bytes in Wire
+// sized chunks. Gives up at the first transfer that fails, so a dead bus
+// costs one I2C_TIMEOUT_US and not one per chunk; see i2c.h
+static void oled_push(uint8_t x0, uint8_t page0, uint8_t x1, uint8_t page1){
+  if (!i2c_start(I2C_OLED)) return;
+
+  // same 400 kHz burst display() does, the DS1307 wants 100 kHz back
+  Wire.setClock(400000);
+  Wire.beginTransmission(OLED_ADDRESS);
+  Wire.write((uint8_t)0x00); // commands follow
+  Wire.write((uint8_t)SSD1306_PAGEADDR);
+  Wire.write(page0);
+  Wire.write(page1);
+  Wire.write((uint8_t)SSD1306_COLUMNADDR);
+  Wire.write(x0);
+  Wire.write(x1);
+  uint8_t status = Wire.endTransmission();
+
+  const uint8_t *buffer = oled.getBuffer();
+  for (uint8_t page = page0; page <= page1 && status == 0; page++) {
+    const uint8_t *p = buffer + page * SCREEN_WIDTH + x0;
+    uint8_t n = x1 - x0 + 1;
+    while (n && status == 0) {
+      uint8_t chunk = n < 31 ? n : 31; // Wire buffer is 32 with the control byte
+      Wire.beginTransmission(OLED_ADDRESS);
+      Wire.write((uint8_t)0x40);
+      Wire.write(p, chunk);
+      status = Wire.endTransmission();
+      p += chunk;
+      n -= chunk;
+    }
+  }
+  Wire.setClock(100000);
+  i2c_done(I2C_OLED, status);
+}
+
+// every frame goes through here so perf.h can count the bus traffic
+void oled_show(){
+  perf_oled_frame();
+  capture_oled(OLED_FRAME_BYTES);
+  if (!TRACE_SKIP_OUTPUT) oled_push(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT / 8 - 1);
+}
+
+void oled_show_rect(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1){
+  uint8_t page0 = y0 / 8;
+  uint8_t page1 = y1 / 8;
+  uint16_t bytes = (uint16_t)(x1 - x0 + 1) * (page1 - page0 + 1);
+
+  capture_oled(perf_oled_rect(bytes));
+  if (!TRACE_SKIP_OUTPUT) oled_push(x0, page0, x1, page1);
+}
+
+// marks each running side timer on the last pixels of the ring
+void ring_timer_flags(){
+  uint16_t flags = timers_count();
+  if (flags > NUM_PIXELS) flags = NUM_PIXELS;
+  ring_fill(NUM_PIXELS - flags, flags, TIMER_FLAG_COLOR);
+}
+
+// completion state: the ring fills up in SWEEP_STEPS frames, so a long strip
+// blocks the loop no longer than the 24 pixel ring does
+void ring_sweep(){
+  for (uint8_t k = 1; k <= SWEEP_STEPS; k++){
+    ring_fill(0, (uint32_t)NUM_PIXELS * k / SWEEP_STEPS, CYCLE_MIN_COLOR);
+    ring_show();
+    clock_delay(LIGHT_DELAY);
+  }
+}
 
+// a countdown on the ring: the first `base` pixels in one colour, the rest of
+// `count` in the other. Two runs whatever the length
+void ring_bar(int count, int base, uint8_t r, uint8_t g, uint8_t b, uint8_t r2, uint8_t g2, uint8_t b2){
+  ring_clear();
+  if (count > base) ring_fill(base, count - base, r2, g2, b2);
+  if (count > 0) ring_fill(0, count < base ? count : base, r, g, b);
+}
 
 int length(int num) {
     return (num == 0) ? 1 : floor(log10(abs(num))) + 1;
 }
 
+bool input_button(){
+#ifdef TRACE_REPLAY
+  return trace_button();
+#else
+  return EncoderButton::read();
+#endif
+}
+
 bool isButtonHeld(){
-  return digitalRead(ENCODER_BUTTON)==LOW;
+  return input_button()==LOW;
 }
 
 int checkButton(unsigned long longPressDuration = 2500) {
@@ -104,11 +239,12 @@ int checkButton(unsigned long longPressDuration = 2500) {
   static unsigned long pressedTime = 0;   // time when button was pressed
   static bool longPressHandled = false;   // ensure only one long press event
 
-  bool buttonState = digitalRead(ENCODER_BUTTON);
+  bool buttonState = input_button();
+  if (buttonState != lastButtonState) trace_record(TRACE_BUTTON);
 
   // Button just pressed
   if (lastButtonState == HIGH && buttonState == LOW) {
-    pressedTime = millis();
+    pressedTime = clock_millis();
     longPressHandled = false;
   }
 
@@ -116,7 +252,7 @@ int checkButton(unsigned long longPressDuration = 2500) {
   if (lastButtonState == LOW && buttonState == LOW) {
     //Serial.print('pressed: ');
     //Serial.print(pressedTime);
-    if (!longPressHandled && millis() - pressedTime >= longPressDuration) {
+    if (!longPressHandled && !knob.held_turn && clock_millis() - pressedTime >= longPressDuration) {
       longPressHandled = true;
       lastButtonState = buttonState;
       Serial.println("long press = TRUE");
@@ -126,7 +262,11 @@ int checkButton(unsigned long longPressDuration = 2500) {
 
   // Button just released
   if (lastButtonState == LOW && buttonState == HIGH) {
-    if (!longPressHandled && millis() - pressedTime < longPressDuration) {
+    // hold+rotate changed the screen, letting go only ends that. Cleared here
+    // and not on the press, the ISR may have turned before loop() saw it
+    bool turned = knob.held_turn;
+    knob.held_turn = false;
+    if (!turned && !longPressHandled && clock_millis() - pressedTime < longPressDuration) {
       lastButtonState = buttonState;
       return 1; // short press detected
     }
@@ -138,490 +278,570 @@ int checkButton(unsigned long longPressDuration = 2500) {
 
 
 void updateEncoder() {
-   // lockout flag
-  CLKstate = digitalRead(ENCODER_CLK);
+  uint8_t CLKstate = EncoderClk::read();
+  perf.encoder_edges++;
+
+  if (CLKstate == knob.clk) {
+    perf.encoder_missed++; // fired on CHANGE but the level is the same, so an edge got lost (or bounced)
+  }
+  else {
+    knob.clk = CLKstate;
+    byte data = EncoderDt::read();
+
+    if (CLKstate == LOW) {
+      bool clockwise = data;
+      trace_record(clockwise ? TRACE_CW : TRACE_CCW);
+      encoder_step(clockwise);
+    }
+  }
+}
 
-  if (CLKstate != lastCLKstate) {
-    lastCLKstate = CLKstate;
-    byte data = digitalRead(ENCODER_DT);
+// straight on the vector, no attachInterrupt() trampoline in between
+#if ENCODER_CLK == 2
+ISR(INT0_vect) {
+  updateEncoder();
+}
+#else
+ISR(INT1_vect) {
+  updateEncoder();
+}
+#endif
 
-    bool clockwise = (data && CLKstate == LOW);
-    bool counterClockwise = (!data && CLKstate == LOW);
+void encoder_step(bool clockwise) {
+    bool counterClockwise = !clockwise;
+    if (clockwise) perf.encoder_cw++;
+    else perf.encoder_ccw++;
 
     // --- Handle hold+rotate for state navigation ---
     if (isButtonHeld()) {
         // only allow *one* rotation per hold
         if (clockwise) {
-          if (currentState == STATE_IDLE) currentState = STATE_CONFIG_STUDY;
-          else if (currentState == STATE_CONFIG_STUDY) {config_study_state(true); currentState = STATE_CONFIG_BREAK;} 
-          else if (currentState == STATE_CONFIG_BREAK) {config_break_state(true); currentState = STATE_CONFIG_CYCLE;}
-          else if (currentState == STATE_CONFIG_TIMER) {config_timer_state(true); currentState = STATE_IDLE;}
+          if (knob.state == STATE_IDLE) knob.state = STATE_CONFIG_STUDY;
+          else if (knob.state == STATE_CONFIG_STUDY) {config_study_state(true); knob.state = STATE_CONFIG_BREAK;} 
+          else if (knob.state == STATE_CONFIG_BREAK) {config_break_state(true); knob.state = STATE_CONFIG_CYCLE;}
+          else if (knob.state == STATE_CONFIG_TIMER) {config_timer_state(true); knob.state = STATE_IDLE;}
           //else if (currentState == STATE_CONFIG_CYCLE) {config_cycle_state(true); currentState = STATE_STUDY;}
         }
         else if (counterClockwise) {
-          if (currentState == STATE_CONFIG_CYCLE) {config_cycle_state(true); currentState = STATE_CONFIG_BREAK;}
-          else if (currentState == STATE_CONFIG_BREAK) {config_break_state(true); currentState = STATE_CONFIG_STUDY;}
-          else if (currentState == STATE_CONFIG_STUDY) {config_study_state(true); currentState = STATE_IDLE;}
-          else if (currentState == STATE_IDLE) {currentState = STATE_CONFIG_TIMER;}
+          if (knob.state == STATE_CONFIG_CYCLE) {config_cycle_state(true); knob.state = STATE_CONFIG_BREAK;}
+          else if (knob.state == STATE_CONFIG_BREAK) {config_break_state(true); knob.state = STATE_CONFIG_STUDY;}
+          else if (knob.state == STATE_CONFIG_STUDY) {config_study_state(true); knob.state = STATE_IDLE;}
+          else if (knob.state == STATE_IDLE) {knob.state = STATE_CONFIG_TIMER;}
           //else if (currentState == STATE_CONFIG_TIMER) {config_timer_state(true);currentState = STATE_TIMER;}
         }
+      knob.held_turn = true; // checkButton(): no short or long press for this hold
+      knob_seq++;
       return; // skip normal time changes
     } 
     
     // --- Normal encoder behavior when not held ---
+    // a running countdown: study_state()/timer_state() move its end
+    if ((knob.state == STATE_STUDY || knob.state == STATE_TIMER) && !knob.paused) {
+      int8_t turned = knob.scrub;
+      if (clockwise ? turned < 127 : turned > -127) knob.scrub = turned + (clockwise ? 1 : -1);
+    }
     if (counterClockwise) {
-      if (currentState == STATE_CONFIG_STUDY && study_time >= (MIN_STUDY_TIME+STUDY_PIXELS_PER_MINS)) {
-        study_time -= STUDY_PIXELS_PER_MINS;
+      if (knob.state == STATE_CONFIG_STUDY && knob.study_time >= (MIN_STUDY_TIME+STUDY_PIXELS_PER_MINS)) {
+        knob.study_time -= STUDY_PIXELS_PER_MINS;
       }
-      else if (currentState == STATE_CONFIG_BREAK && break_time >= (MIN_BREAK_TIME+BREAK_PIXELS_PER_MINS)) {
-        break_time -= BREAK_PIXELS_PER_MINS;
+      else if (knob.state == STATE_CONFIG_BREAK && knob.break_time >= (MIN_BREAK_TIME+BREAK_PIXELS_PER_MINS)) {
+        knob.break_time -= BREAK_PIXELS_PER_MINS;
       }
-      else if (currentState == STATE_CONFIG_CYCLE && cycle >= (MIN_CYCLE_TIME+CYCLE_PIXELS_PER_MINS)) {
-        cycle -= CYCLE_PIXELS_PER_MINS;
-      }else if (currentState == STATE_CONFIG_TIMER && timer_time >= (MIN_TIMER_TIME+TIMER_PIXELS_PER_MINS)) {
-        timer_time -= TIMER_PIXELS_PER_MINS;
+      else if (knob.state == STATE_CONFIG_CYCLE && knob.cycle >= (MIN_CYCLE_TIME+CYCLE_PIXELS_PER_MINS)) {
+        knob.cycle -= CYCLE_PIXELS_PER_MINS;
+      }else if (knob.state == STATE_CONFIG_TIMER && knob.timer_time >= (MIN_TIMER_TIME+TIMER_PIXELS_PER_MINS)) {
+        knob.timer_time -= TIMER_PIXELS_PER_MINS;
       }
     }
     else if (clockwise) {
-      if (currentState == STATE_CONFIG_STUDY && study_time <= (MAX_STUDY_TIME-STUDY_PIXELS_PER_MINS)) {
-        study_time += STUDY_PIXELS_PER_MINS;
+      if (knob.state == STATE_CONFIG_STUDY && knob.study_time <= (MAX_STUDY_TIME-STUDY_PIXELS_PER_MINS)) {
+        knob.study_time += STUDY_PIXELS_PER_MINS;
       }
-      else if (currentState == STATE_CONFIG_BREAK && break_time <= (MAX_BREAK_TIME-BREAK_PIXELS_PER_MINS)) {
-        break_time += BREAK_PIXELS_PER_MINS;
+      else if (knob.state == STATE_CONFIG_BREAK && knob.break_time <= (MAX_BREAK_TIME-BREAK_PIXELS_PER_MINS)) {
+        knob.break_time += BREAK_PIXELS_PER_MINS;
       }
-      else if (currentState == STATE_CONFIG_CYCLE && cycle <= (MAX_CYCLE_TIME-CYCLE_PIXELS_PER_MINS)) {
-        cycle += CYCLE_PIXELS_PER_MINS;
+      else if (knob.state == STATE_CONFIG_CYCLE && knob.cycle <= (MAX_CYCLE_TIME-CYCLE_PIXELS_PER_MINS)) {
+        knob.cycle += CYCLE_PIXELS_PER_MINS;
       }
-      else if (currentState == STATE_CONFIG_TIMER && timer_time <= (MAX_TIMER_TIME-TIMER_PIXELS_PER_MINS)) {
-        timer_time += TIMER_PIXELS_PER_MINS;
+      else if (knob.state == STATE_CONFIG_TIMER && knob.timer_time <= (MAX_TIMER_TIME-TIMER_PIXELS_PER_MINS)) {
+        knob.timer_time += TIMER_PIXELS_PER_MINS;
       }
     }
-  }
+    knob_seq++; // knob_snapshot() callers retry
 }
 
 
-void idle_state() {
-  static unsigned long lastUpdate = 0;
-  unsigned long nowMillis = millis();
-
-  // oled.ssd1306_command(SSD1306_SETCONTRAST);
-  // oled.ssd1306_command(0x7F);
-
-  NeoPixel.clear();
-  NeoPixel.show();
-
-  if (nowMillis - lastUpdate >= 500) {   // update every 0.5s
-    lastUpdate = nowMillis;
-
-    DateTime now = rtc.now();
-
-    char left[3], right[3];
-    int xLeft = 1; 
-    int xRight = 73;
-
-    int displayHour = now.hour() % 12;
-    if (displayHour == 0) displayHour = 12; // handle midnight / noon
-    int minutes = now.minute();
-
-    sprintf(left, "%02d", displayHour);
-    sprintf(right, "%02d", minutes);
+// Everything a screen shows. Screens are only redrawn when this changes, so a
+// config or idle screen that sits still costs no sprintf, drawing or I2C.
+struct ScreenModel {
+  uint8_t mode;     // State the screen belongs to
+  uint8_t hours;
+  uint8_t minutes;
+  uint8_t sessions;
+  uint8_t timers;   // side timer flags along the bottom
+  bool paused;
+  uint8_t focus_hours;       // idle: today's focus, see stats.h
+  uint8_t focus_minutes;
+  uint8_t streak;
+  uint8_t spark[STATS_DAYS]; // bar heights, oldest day first
+};
 
-    // Adjust position if first digit is '1'
-    if (left[0] == '1' && left[1] == '1'){
-      xLeft +=40;
-    }
+#define SPARK_HEIGHT 16
 
-    if (left[0] == '1' && left[1] != '1') {
-        xLeft += 20;
-    }
+ScreenModel shownScreen;
+bool screenValid = false;
+int shownRing = -1; // idle ring pixel count last sent, -1 = unknown
 
-    if (left[0] != '1' && left[1] == '1') {
-        xLeft += 20;
-    }
-    
+// somebody else drew over the oled/ring, next screen has to go out in full
+void invalidate_view(){
+  screenValid = false;
+  shownRing = -1;
+}
 
-    oled.clearDisplay();
+// the oled missed pushes while its bus was down, maybe halfway through a
+// slide: start line back to 0 and everything out again
+void oled_recover(){
+  if (i2c_start(I2C_OLED)) {
+    oled.ssd1306_command(SSD1306_SETSTARTLINE);
+    i2c_done(I2C_OLED);
+  }
+  invalidate_view();
+}
 
-    // Big clock digits
-    oled.setTextSize(5);
-    oled.setFont(&Org_01);
-    oled.setTextColor(SSD1306_WHITE);
+ScreenModel make_screen(uint8_t mode, int hours, int minutes){
+  ScreenModel m;
+  memset(&m, 0, sizeof(m)); // padding too, the models get memcmp'd
+  m.mode = mode;
+  m.hours = hours;
+  m.minutes = minutes;
+  return m;
+}
 
-    oled.setCursor(xLeft, 36);
-    oled.print(left);
+// config screens show a duration as big h:mm with H/M labels underneath
+ScreenModel duration_screen(uint8_t mode, int mins){
+  return make_screen(mode, mins / 60, mins % 60);
+}
 
-    oled.setCursor(xRight, 36);
-    oled.print(right);
+#ifdef SCREENS_HANDWRITTEN
 
-    // Separator dots
-    oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-    oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-    oled.display();
-}
+// The screens as they were before layout.h, kept to compare flash use and
+// draw time against: pio run -e screens_handwritten
 
+// small squares along the bottom of the oled, the focused (soonest) one filled
+void oled_timer_flags(){
+  for (uint8_t i = 0; i < timers_count(); i++) {
+    if (i == 0) oled.fillRect(2 + i * 6, 59, 4, 4, SSD1306_WHITE);
+    else oled.drawRect(2 + i * 6, 59, 4, 4, SSD1306_WHITE);
+  }
 }
 
-void config_study_state(bool reset=false){
-  static int pixels_to_show = -1;
+void draw_clock(const ScreenModel &m){
+  char left[3], right[3];
+  int xLeft = 1; 
+  int xRight = 73;
 
-  if (reset) {
-    pixels_to_show = -1;
-    return;   // reset on demand
+  sprintf(left, "%02d", m.hours);
+  sprintf(right, "%02d", m.minutes);
 
+  // Adjust position if first digit is '1'
+  if (left[0] == '1' && left[1] == '1'){
+    xLeft +=40;
   }
 
-  if (pixels_to_show == -1) {
-        NeoPixel.clear();
-        pixels_to_show = floor(study_time / STUDY_PIXELS_PER_MINS) - 1;
-        Serial.println("pixels to show: ");
-        Serial.println(pixels_to_show);
-        for (int i = 0; i <= pixels_to_show; i++) {
-            if (i<= floor(MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(i, NeoPixel.Color(STUDY_MIN_COLOR));}
-            else{
-              NeoPixel.setPixelColor(i, NeoPixel.Color(STUDY_ADDITIONAL_TIME));}
-              
-            NeoPixel.show();
-            delay(LIGHT_DELAY); 
-        }
+  if (left[0] == '1' && left[1] != '1') {
+      xLeft += 20;
+  }
 
-        char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
+  if (left[0] != '1' && left[1] == '1') {
+      xLeft += 20;
+  }
 
-        int displayHour = study_time / 60;   // integer division gives full hours
-        int minutes = study_time % 60; // remainder gives remaining minutes
+  // Big clock digits
+  oled.setTextSize(5);
+  oled.setFont(&Org_01);
+  oled.setTextColor(SSD1306_WHITE);
 
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
+  oled.setCursor(xLeft, 36);
+  oled.print(left);
 
-        // Adjust position if first digit is '1'
+  oled.setCursor(xRight, 36);
+  oled.print(right);
 
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
+  // Separator dots
+  oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
+  oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
+  oled_timer_flags();
+}
 
-        oled.clearDisplay();
+void draw_duration(const ScreenModel &m){
+  char left[3], right[3];
+  int xLeft = 1; 
+  int xRight = 73;
 
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
+  sprintf(left, "%d", m.hours);
+  sprintf(right, "%02d", m.minutes);
 
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
+  // Adjust position if first digit is '1'
+  if (left[0] == '1') {
+      xLeft += 50;
+  }
+  else {
+      xLeft += 30;
+  }
 
-        oled.setCursor(xRight, 36);
-        oled.print(right);
+  // Big clock digits
+  oled.setTextSize(5);
+  oled.setFont(&Org_01);
+  oled.setTextColor(SSD1306_WHITE);
 
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-    }
-  
-  //check if one more pixel has been added : means time increased.
-  else if ((floor(study_time / STUDY_PIXELS_PER_MINS)-1)-pixels_to_show==1){
-      pixels_to_show++;
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(STUDY_ADDITIONAL_TIME));
-      NeoPixel.show();
+  oled.setCursor(xLeft, 36);
+  oled.print(left);
 
-      char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
+  oled.setCursor(xRight, 36);
+  oled.print(right);
 
-        int displayHour = study_time / 60;   // integer division gives full hours
-        int minutes = study_time % 60; // remainder gives remaining minutes
+  // Separator dots
+  oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
+  oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
 
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
+  // unit labels
+  oled.setTextSize(1);
+  oled.setCursor(51, 50);
+  oled.print("H");
+  oled.setCursor(xRight, 50);
+  oled.print("M");
+}
 
-        // Adjust position if first digit is '1'
+void draw_screen(const ScreenModel &m){
+  if (m.paused) {
+    oled.setTextColor(WHITE);
+    oled.setCursor(0,40);
+    oled.setTextSize(5);
+    oled.setFont(&Picopixel);
+    oled.print("PAUSED!");
+  }
+  else if (m.mode == STATE_IDLE) {
+    draw_clock(m);
+  }
+  else if (m.mode == STATE_CONFIG_CYCLE) {
+    oled.setFont(&Picopixel);
+    oled.setCursor(3,35);
+    oled.setTextSize(4);
+    oled.print("SESSIONS");
+  }
+  else if (m.mode == STATE_CONFIG_STUDY || m.mode == STATE_CONFIG_BREAK || m.mode == STATE_CONFIG_TIMER) {
+    draw_duration(m);
+  }
+  else {
+    oled_timer_flags();
+  }
+}
 
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
+#else
+
+#define FIELD(name) offsetof(ScreenModel, name)
+
+static const char label_h[] PROGMEM = "H";
+static const char label_m[] PROGMEM = "M";
+static const char label_sessions[] PROGMEM = "SESSIONS";
+static const char label_paused[] PROGMEM = "PAUSED!";
+static const char label_colon[] PROGMEM = ":";
+static const char label_days[] PROGMEM = "D";
+
+// Big h:mm in Org_01 at size 5, where a digit advances 30 px and a '1' only
+// 10, so the hours are right aligned against the colon. Digits are 5 rows
+// of 5 px above the baseline, rows 11..35.
+static const LayoutItem clock_layout[] PROGMEM = {
+  layout_number(FIELD(hours), 1, 11, 60, 25, 36, &Org_01, 5, LAYOUT_PAD2 | LAYOUT_RIGHT),
+  layout_number(FIELD(minutes), 73, 11, 55, 25, 36, &Org_01, 5, LAYOUT_PAD2),
+  layout_rect(62, 21, 5, 5),
+  layout_rect(62, 31, 5, 5),
+  layout_pips(FIELD(timers), 2, 59, MAX_TIMERS, 4), // side timers, the soonest filled
+  // today's focus as h:mm, the streak in days and the last 7 days as bars
+  layout_number(FIELD(focus_hours), 2, 48, 12, 6, 54, &Org_01, 1, LAYOUT_RIGHT),
+  layout_text(label_colon, 14, 54, &Org_01, 1),
+  layout_number(FIELD(focus_minutes), 16, 48, 12, 6, 54, &Org_01, 1, LAYOUT_PAD2),
+  layout_number(FIELD(streak), 40, 48, 18, 6, 54, &Org_01, 1, LAYOUT_RIGHT),
+  layout_text(label_days, 59, 54, &Org_01, 1),
+  layout_bar(FIELD(spark[0]), 100, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[1]), 104, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[2]), 108, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[3]), 112, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[4]), 116, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[5]), 120, 38, 3, SPARK_HEIGHT),
+  layout_bar(FIELD(spark[6]), 124, 38, 3, SPARK_HEIGHT),
+  layout_end(),
+};
 
-        oled.clearDisplay();
+// config screens show a duration, with H/M labels underneath
+static const LayoutItem duration_layout[] PROGMEM = {
+  layout_number(FIELD(hours), 1, 11, 60, 25, 36, &Org_01, 5, LAYOUT_RIGHT),
+  layout_number(FIELD(minutes), 73, 11, 55, 25, 36, &Org_01, 5, LAYOUT_PAD2),
+  layout_rect(62, 21, 5, 5),
+  layout_rect(62, 31, 5, 5),
+  layout_text(label_h, 51, 50, &Org_01, 1),
+  layout_text(label_m, 73, 50, &Org_01, 1),
+  layout_end(),
+};
 
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
+static const LayoutItem sessions_layout[] PROGMEM = {
+  layout_text(label_sessions, 3, 35, &Picopixel, 4),
+  layout_end(),
+};
 
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
+static const LayoutItem paused_layout[] PROGMEM = {
+  layout_text(label_paused, 0, 40, &Picopixel, 5),
+  layout_end(),
+};
 
-        oled.setCursor(xRight, 36);
-        oled.print(right);
+// running countdowns: the dial draws the rest itself
+static const LayoutItem running_layout[] PROGMEM = {
+  layout_pips(FIELD(timers), 2, 59, MAX_TIMERS, 4),
+  layout_end(),
+};
 
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-      
+static const LayoutItem *screen_layout(const ScreenModel &m){
+  if (m.paused) return paused_layout;
+  switch (m.mode) {
+    case STATE_IDLE: return clock_layout;
+    case STATE_CONFIG_CYCLE: return sessions_layout;
+    case STATE_CONFIG_STUDY:
+    case STATE_CONFIG_BREAK:
+    case STATE_CONFIG_TIMER: return duration_layout;
+    default: return running_layout;
   }
+}
 
-  else if ((floor(study_time / STUDY_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(0,0,0));
-      pixels_to_show--;
-      NeoPixel.show();
-
-      char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
+#endif
 
-        int displayHour = study_time / 60;   // integer division gives full hours
-        int minutes = study_time % 60; // remainder gives remaining minutes
+// the clock and the config screens slide into each other: deeper into
+// the settings goes up, back towards the clock goes down
+static bool slides_between(uint8_t from, uint8_t to){
+  return from != to && from <= STATE_CONFIG_TIMER && to <= STATE_CONFIG_TIMER;
+}
 
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
+void render_screen(const ScreenModel &m){
+  static uint8_t panelMode = STATE_IDLE; // what the panel shows, across invalidate_view()
+  static bool panelPaused = false;
+  bool slide = !m.paused && !panelPaused && slides_between(panelMode, m.mode);
+  TransitionDir dir = m.mode > panelMode ? SLIDE_UP : SLIDE_DOWN;
+  panelMode = m.mode;
+  panelPaused = m.paused;
 
-        // Adjust position if first digit is '1'
+  unsigned long start = micros();
+  oled.clearDisplay();
+#ifdef SCREENS_HANDWRITTEN
+  draw_screen(m);
+#else
+  layout_draw(screen_layout(m), &m);
+#endif
+  perf.screen_draw_us += micros() - start;
+  perf.screens_full++;
+
+  // running countdown: the dial fills itself in on the next update
+  if (!m.paused && m.mode >= STATE_STUDY) dial_reset();
+
+  if (slide) oled_transition(dir);
+  else oled_show();
+}
 
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
+void show_screen(const ScreenModel &m){
+  if (screenValid && memcmp(&m, &shownScreen, sizeof(m)) == 0) return;
+
+#ifndef SCREENS_HANDWRITTEN
+  // same screen, other values: only the bound fields that changed
+  if (screenValid && m.mode == shownScreen.mode && screen_layout(m) == screen_layout(shownScreen)) {
+    unsigned long start = micros();
+    LayoutBox box;
+    bool dirty = layout_update(screen_layout(m), &m, &shownScreen, &box);
+    perf.screen_draw_us += micros() - start;
+    perf.screens_partial++;
+    if (dirty) oled_show_rect(box.x0, box.y0, box.x1, box.y1);
+    shownScreen = m;
+    return;
+  }
+#endif
 
-        oled.clearDisplay();
+  shownScreen = m;
+  screenValid = true;
+  render_screen(m);
+}
 
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
+// detents turned since the last call, zeroed in the same go so none that
+// land in between get lost
+static int8_t take_scrub(){
+  noInterrupts();
+  int8_t turned = knob.scrub;
+  knob.scrub = 0;
+  interrupts();
+  return turned;
+}
 
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
+// Rotation while a countdown runs moves its end, one ring pixel's worth of
+// minutes per detent. The session (what ran plus what is left) stays within
+// lo..hi, and at least one step is always left. Nothing is cleared or
+// restarted: the ring bar and the dial follow on the same pass
+static void scrub(int *left, int *total, int step, int lo, int hi){
+  int8_t turned = take_scrub();
+  if (!turned) return;
+
+  int elapsed = *total - *left;
+  int t = *total + turned * step;
+  if (t > hi) t = hi;
+  if (t < lo) t = lo;
+  if (t - elapsed < step) t = elapsed + step;
+  *left = t - elapsed;
+  *total = t;
+}
 
-        oled.setCursor(xRight, 36);
-        oled.print(right);
+// whole minutes still on a countdown plus the seconds since its last tick
+void show_progress(int remaining_min, int total_min, long since_tick){
+  long left = remaining_min * 60L - since_tick * 60 / SECONDS_PER_MIN;
+  if (left < 0) left = 0;
+  dial_update(left, total_min * 60L);
+}
 
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
+// a weekly schedule entry came up while the clock was showing
+static void start_scheduled(const ScheduleEntry &e){
+  if (e.days & SCHEDULE_TIMER) {
+    knob.timer_time = e.work;
+    enter_state(STATE_TIMER);
+  } else {
+    static_assert(MAX_BREAK_TIME <= 15 && MAX_CYCLE_TIME <= 15, "ScheduleEntry::rest packs both in a nibble");
+    knob.study_time = e.work;
+    knob.break_time = e.rest >> 4;
+    knob.cycle = e.rest & 15;
+    enter_state(STATE_STUDY);
   }
-  
-  char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = study_time / 60;   // integer division gives full hours
-        int minutes = study_time % 60; // remainder gives remaining minutes
+  Serial.println("schedule: started");
+}
 
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
+void idle_state() {
+  static unsigned long lastUpdate = 0;
+  unsigned long nowMillis = clock_millis();
+
+  // with side timers running the ring counts down the soonest one
+  int pixels_to_show = 0;
+  const KnobTimer *focused = timers_next();
+  if (focused) {
+    long left = focused->deadline - nowMillis;
+    if (left < 0) left = 0;
+    unsigned long mins = (left + SECONDS_PER_MIN * 1000UL - 1) / (SECONDS_PER_MIN * 1000UL);
+    pixels_to_show = (mins + TIMER_PIXELS_PER_MINS - 1) / TIMER_PIXELS_PER_MINS;
+    if (pixels_to_show > NUM_PIXELS) pixels_to_show = NUM_PIXELS;
+  }
+  if (pixels_to_show != shownRing) {
+    ring_clear();
+    ring_fill(0, pixels_to_show, TIMER_ADDITIONAL_TIME);
+    ring_show();
+    shownRing = pixels_to_show;
+  }
 
+  if (nowMillis - lastUpdate >= 500 || !screenValid) {   // check the time every 0.5s
+    lastUpdate = nowMillis;
 
-        xLeft+=50;
-        
-      
-        // Big clock digits
-        oled.setTextSize(1);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
+    DateTime now = clock_now();
 
-        oled.setCursor(xLeft, 50);
-        oled.print("H");
+    const ScheduleEntry *due = schedule_due(now.unixtime());
+    if (due) {
+      start_scheduled(*due);
+      return;
+    }
 
-        oled.setCursor(xRight, 50);
-        oled.print("M");
+    stats_day(now.unixtime());
 
-        // Separator dots
-        oled.display();
+    int displayHour = now.hour() % 12;
+    if (displayHour == 0) displayHour = 12; // handle midnight / noon
 
+    ScreenModel m = make_screen(STATE_IDLE, displayHour, now.minute());
+    m.timers = timers_count();
+    uint16_t focus = stats_today();
+    m.focus_hours = focus / 60;
+    m.focus_minutes = focus % 60;
+    m.streak = stats_streak();
+    for (uint8_t i = 0; i < STATS_DAYS; i++) m.spark[i] = stats_bar(STATS_DAYS - 1 - i, SPARK_HEIGHT);
+    show_screen(m);
+  }
 }
 
-void config_break_state(bool reset=false){
+void config_study_state(bool reset=false){
   static int pixels_to_show = -1;
 
   if (reset) {
-    pixels_to_show = -1;   // reset on demand
-    return;
+    pixels_to_show = -1;
+    return;   // reset on demand
   }
 
   if (pixels_to_show == -1) {
-        NeoPixel.clear();
-        pixels_to_show = floor(break_time / BREAK_PIXELS_PER_MINS) - 1;
+        ring_clear();
+        pixels_to_show = floor(knob.study_time / STUDY_PIXELS_PER_MINS) - 1;
         Serial.println("pixels to show: ");
         Serial.println(pixels_to_show);
         for (int i = 0; i <= pixels_to_show; i++) {
-            if (i<= floor(MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(i, NeoPixel.Color(BREAK_MIN_COLOR));}
+            if (i<= floor(MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS)-1){
+              ring_set(i, STUDY_MIN_COLOR);}
             else{
-            NeoPixel.setPixelColor(i, NeoPixel.Color(BREAK_ADDITIONAL_TIME));}
-
-            NeoPixel.show();
-            delay(LIGHT_DELAY); 
-        }
-
-        char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = break_time / 60;   // integer division gives full hours
-        int minutes = break_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-        // Adjust position if first digit is '1'
-
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
+              ring_set(i, STUDY_ADDITIONAL_TIME);}
+              
+            ring_show();
+            clock_delay(LIGHT_DELAY); 
         }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-        
     }
   
   //check if one more pixel has been added : means time increased.
-  else if ((floor(break_time / BREAK_PIXELS_PER_MINS)-1)-pixels_to_show==1){
+  else if ((floor(knob.study_time / STUDY_PIXELS_PER_MINS)-1)-pixels_to_show==1){
       pixels_to_show++;
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(BREAK_ADDITIONAL_TIME));
-      NeoPixel.show();
-
-      char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = break_time / 60;   // integer division gives full hours
-        int minutes = break_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-        // Adjust position if first digit is '1'
-
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-
-      
+      ring_set(pixels_to_show, STUDY_ADDITIONAL_TIME);
+      ring_show();
   }
 
-  else if ((floor(break_time / BREAK_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(0,0,0));
+  else if ((floor(knob.study_time / STUDY_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
+      ring_set(pixels_to_show, 0,0,0);
       pixels_to_show--;
-      NeoPixel.show();
+      ring_show();
+  }
 
-      char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
+  show_screen(duration_screen(STATE_CONFIG_STUDY, knob.study_time));
+}
 
-        int displayHour = break_time / 60;   // integer division gives full hours
-        int minutes = break_time % 60; // remainder gives remaining minutes
+void config_break_state(bool reset=false){
+  static int pixels_to_show = -1;
 
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
+  if (reset) {
+    pixels_to_show = -1;   // reset on demand
+    return;
+  }
 
-        // Adjust position if first digit is '1'
+  if (pixels_to_show == -1) {
+        ring_clear();
+        pixels_to_show = floor(knob.break_time / BREAK_PIXELS_PER_MINS) - 1;
+        Serial.println("pixels to show: ");
+        Serial.println(pixels_to_show);
+        for (int i = 0; i <= pixels_to_show; i++) {
+            if (i<= floor(MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS)-1){
+              ring_set(i, BREAK_MIN_COLOR);}
+            else{
+            ring_set(i, BREAK_ADDITIONAL_TIME);}
 
-        if (left[0] == '1') {
-            xLeft += 50;
+            ring_show();
+            clock_delay(LIGHT_DELAY); 
         }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-
-      
-  }
+    }
   
-  char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = break_time / 60;   // integer division gives full hours
-        int minutes = break_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-
-        xLeft+=50;
-        
-      
-        // Big clock digits
-        oled.setTextSize(1);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 50);
-        oled.print("H");
-
-        oled.setCursor(xRight, 50);
-        oled.print("M");
+  //check if one more pixel has been added : means time increased.
+  else if ((floor(knob.break_time / BREAK_PIXELS_PER_MINS)-1)-pixels_to_show==1){
+      pixels_to_show++;
+      ring_set(pixels_to_show, BREAK_ADDITIONAL_TIME);
+      ring_show();
+  }
 
-        // Separator dots
-        oled.display();
+  else if ((floor(knob.break_time / BREAK_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
+      ring_set(pixels_to_show, 0,0,0);
+      pixels_to_show--;
+      ring_show();
+  }
 
+  show_screen(duration_screen(STATE_CONFIG_BREAK, knob.break_time));
 }
 
 void config_cycle_state(bool reset=false){
@@ -633,18 +853,18 @@ void config_cycle_state(bool reset=false){
   }
 
   if (pixels_to_show == -1) {
-        NeoPixel.clear();
-        pixels_to_show = floor(cycle * CYCLE_PIXELS_PER_MINS) - 1;
+        ring_clear();
+        pixels_to_show = floor(knob.cycle * CYCLE_PIXELS_PER_MINS) - 1;
         Serial.println("pixels to show: ");
         Serial.println(pixels_to_show);
         for (int i = 0; i <= pixels_to_show; i++) {
             if (i<= floor(MIN_CYCLE_TIME / CYCLE_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(i, NeoPixel.Color(CYCLE_MIN_COLOR));}
+              ring_set(i, CYCLE_MIN_COLOR);}
             else{
-            NeoPixel.setPixelColor(i, NeoPixel.Color(CYCLE_ADDITIONAL_TIME));}
+            ring_set(i, CYCLE_ADDITIONAL_TIME);}
 
-            NeoPixel.show();
-            delay(LIGHT_DELAY); 
+            ring_show();
+            clock_delay(LIGHT_DELAY); 
         }
 
         // oled.clearDisplay();
@@ -655,14 +875,13 @@ void config_cycle_state(bool reset=false){
         // oled.setTextSize(5);
         // oled.setFont(&Org_01);
         // oled.print(cycle);
-        
     }
   
   //check if one more pixel has been added : means time increased.
-  else if ((floor(cycle / CYCLE_PIXELS_PER_MINS)-1)-pixels_to_show==1){
+  else if ((floor(knob.cycle / CYCLE_PIXELS_PER_MINS)-1)-pixels_to_show==1){
       pixels_to_show++;
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(CYCLE_ADDITIONAL_TIME));
-      NeoPixel.show();
+      ring_set(pixels_to_show, CYCLE_ADDITIONAL_TIME);
+      ring_show();
 
       // oled.clearDisplay();
       //   if (cycle==1){
@@ -672,15 +891,12 @@ void config_cycle_state(bool reset=false){
       //   oled.setTextSize(5);
       //   oled.setFont(&Org_01);
       //   oled.print(cycle);
-        
-
-      
   }
 
-  else if ((floor(cycle / CYCLE_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(0,0,0));
+  else if ((floor(knob.cycle / CYCLE_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
+      ring_set(pixels_to_show, 0,0,0);
       pixels_to_show--;
-      NeoPixel.show();
+      ring_show();
 
       // oled.clearDisplay();
       //   if (cycle==1){
@@ -690,17 +906,11 @@ void config_cycle_state(bool reset=false){
       //   oled.setTextSize(5);
       //   oled.setFont(&Org_01);
       //   oled.print(cycle);
-        
-
-      
   }
-  oled.clearDisplay();
-  oled.setFont(&Picopixel);
-  oled.setCursor(3,35);
-  oled.setTextSize(4);
-  oled.print("SESSIONS");
-  oled.display();
 
+  ScreenModel m = make_screen(STATE_CONFIG_CYCLE, 0, 0);
+  m.sessions = knob.cycle;
+  show_screen(m);
 }
 
 void config_timer_state(bool reset=false){
@@ -709,197 +919,44 @@ void config_timer_state(bool reset=false){
   if (reset) {
     pixels_to_show = -1;
     return;   // reset on demand
-
   }
 
   if (pixels_to_show == -1) {
-        NeoPixel.clear();
-        pixels_to_show = floor(timer_time / TIMER_PIXELS_PER_MINS) - 1;
+        ring_clear();
+        pixels_to_show = floor(knob.timer_time / TIMER_PIXELS_PER_MINS) - 1;
         Serial.println("pixels to show: ");
         Serial.println(pixels_to_show);
         for (int i = 0; i <= pixels_to_show; i++) {
             if (i<= floor(MIN_TIMER_TIME / TIMER_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(i, NeoPixel.Color(TIMER_MIN_COLOR));}
+              ring_set(i, TIMER_MIN_COLOR);}
             else{
-              NeoPixel.setPixelColor(i, NeoPixel.Color(TIMER_ADDITIONAL_TIME));}
+              ring_set(i, TIMER_ADDITIONAL_TIME);}
               
-            NeoPixel.show();
-            delay(LIGHT_DELAY); 
-        }
-
-
-        char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = timer_time / 60;   // integer division gives full hours
-        int minutes = timer_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-        // Adjust position if first digit is '1'
-
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
+            ring_show();
+            clock_delay(LIGHT_DELAY); 
         }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
     }
   
   //check if one more pixel has been added : means time increased.
-  else if ((floor(timer_time / TIMER_PIXELS_PER_MINS)-1)-pixels_to_show==1){
+  else if ((floor(knob.timer_time / TIMER_PIXELS_PER_MINS)-1)-pixels_to_show==1){
       pixels_to_show++;
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(TIMER_ADDITIONAL_TIME));
-      NeoPixel.show();
-
-      
-        char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = timer_time / 60;   // integer division gives full hours
-        int minutes = timer_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-        // Adjust position if first digit is '1'
-
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-      
+      ring_set(pixels_to_show, TIMER_ADDITIONAL_TIME);
+      ring_show();
   }
 
-  else if ((floor(timer_time / TIMER_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
-      NeoPixel.setPixelColor(pixels_to_show, NeoPixel.Color(0,0,0));
+  else if ((floor(knob.timer_time / TIMER_PIXELS_PER_MINS)-1)-pixels_to_show==-1){
+      ring_set(pixels_to_show, 0,0,0);
       pixels_to_show--;
-      NeoPixel.show();
-
-        
-        char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = timer_time / 60;   // integer division gives full hours
-        int minutes = timer_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-        // Adjust position if first digit is '1'
-
-        if (left[0] == '1') {
-            xLeft += 50;
-        }
-        else if (left[0] != '1'){
-            xLeft+=30;
-        }
-
-        oled.clearDisplay();
-
-        // Big clock digits
-        oled.setTextSize(5);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 36);
-        oled.print(left);
-
-        oled.setCursor(xRight, 36);
-        oled.print(right);
-
-        // Separator dots
-        oled.fillRect(62, 21, 5, 5,  SSD1306_WHITE);
-        oled.fillRect(62, 31, 5, 5, SSD1306_WHITE);
-        oled.display();
-
-      
+      ring_show();
   }
 
-  char left[3], right[3];
-        int xLeft = 1; 
-        int xRight = 73;
-
-        int displayHour = timer_time / 60;   // integer division gives full hours
-        int minutes = timer_time % 60; // remainder gives remaining minutes
-
-        sprintf(left, "%d", displayHour);
-        sprintf(right, "%02d", minutes);
-
-
-        xLeft+=50;
-        
-      
-        // Big clock digits
-        oled.setTextSize(1);
-        oled.setFont(&Org_01);
-        oled.setTextColor(SSD1306_WHITE);
-
-        oled.setCursor(xLeft, 50);
-        oled.print("H");
-
-        oled.setCursor(xRight, 50);
-        oled.print("M");
-
-        // oled.setTextSize(2);
-        // oled.setCursor(60,55);
-        // oled.print("T");
-
-        
-        //oled.clearDisplay();
-        // oled.setTextSize(1);
-        // oled.setFont(&Picopixel);
-        // oled.setCursor(27,55);
-        // oled.print("TIMER");
-        oled.display();
-  
+  show_screen(duration_screen(STATE_CONFIG_TIMER, knob.timer_time));
 }
 
 void study_state(bool reset=false) {
     static DateTime last;
     static int temp_study_time = -1;
+    static int total_study_time = 0;
     static int session = 1;
     static bool justStarted = false;
 
@@ -909,81 +966,78 @@ void study_state(bool reset=false) {
     if (reset) {
       temp_study_time = -1;
       justStarted = false;
+      stats_save(); // a stopped session keeps the minutes it ran
       if (pomodoro_mode==true){pomodoro_mode=false;}
-      NeoPixel.clear();
-      NeoPixel.show();
+      ring_clear();
+      ring_show();
       return;
     }
 
-    if (paused) {
-      oled.clearDisplay();
-      oled.setTextColor(WHITE);
-      oled.setCursor(0,40);
-      oled.setTextSize(5);
-      oled.setFont(&Picopixel);
-      oled.print("PAUSED!");
-      oled.display();
-      return;
-    }
+    ScreenModel screen = make_screen(knob.state, 0, 0);
+    screen.paused = knob.paused;
+    screen.timers = timers_count();
+    show_screen(screen);
+    if (knob.paused) return;
 
     if (temp_study_time == -1) {
         if (pomodoro_mode){
           temp_study_time=MIN_STUDY_TIME;
         } else {
-          temp_study_time = study_time;
+          temp_study_time = knob.study_time;
         }
+        total_study_time = temp_study_time;
 
-        NeoPixel.clear();
+        ring_clear();
         int pixels_to_show = floor(temp_study_time / STUDY_PIXELS_PER_MINS);
         for (int pixel = 0; pixel < pixels_to_show; pixel++) {
             if (pixel<= floor(MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(STUDY_MIN_COLOR));
+              ring_set(pixel, STUDY_MIN_COLOR);
             } else {
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(STUDY_ADDITIONAL_TIME));
+              ring_set(pixel, STUDY_ADDITIONAL_TIME);
             }
-            NeoPixel.show();
-            delay(LIGHT_DELAY);
+            ring_show();
+            clock_delay(LIGHT_DELAY);
         }  
-        last = rtc.now();
+        last = clock_now();
         justStarted = true;   // block timer subtraction on first loop
     }
+    scrub(&temp_study_time, &total_study_time, STUDY_PIXELS_PER_MINS, MIN_STUDY_TIME, MAX_STUDY_TIME);
 
     // Always show session info
 
     // NeoPixel refresh
-    NeoPixel.clear();
     int pixels_to_show = floor(temp_study_time / STUDY_PIXELS_PER_MINS);
-    for (int pixel = 0; pixel < pixels_to_show; pixel++) {
-        if (pixel<= floor(MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS)-1){
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(STUDY_MIN_COLOR));
-        } else {
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(STUDY_ADDITIONAL_TIME));
-        }        
-    }
-    NeoPixel.show();
+    ring_bar(pixels_to_show, MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS, STUDY_MIN_COLOR, STUDY_ADDITIONAL_TIME);
+    ring_timer_flags();
+    ring_show();
 
     // Timer logic
-    DateTime now = rtc.now();
+    DateTime now = clock_now();
     long diffSeconds = now.unixtime() - last.unixtime();
     
     if (!justStarted && diffSeconds >= 5) {   
         last = now;
         temp_study_time -= STUDY_PIXELS_PER_MINS;
+        stats_focus(now.unixtime(), STUDY_PIXELS_PER_MINS);
     }
     justStarted = false; // only skip once
 
+    if (temp_study_time > 0) show_progress(temp_study_time, total_study_time, now.unixtime() - last.unixtime());
+
     // End of session
     if (temp_study_time <= 0) {
         temp_study_time = -1;
-        if(session==cycle){
+        stats_save();
+        if(session==knob.cycle){
           session=1;
         } else {
           session++;
         }
-        NeoPixel.clear();
-        NeoPixel.show();       
-        delay(100);
-        currentState = STATE_BREAK; 
+        piezo_play(melody_study_done, PIEZO_CHIME, 1);
+        ring_clear();
+        ring_show();       
+        clock_delay(100);
+        knob.state = STATE_BREAK; 
     }
 }
 
@@ -992,6 +1046,7 @@ void study_state(bool reset=false) {
 void break_state(bool reset=false){
     static DateTime last;
     static int temp_break_time = -1;
+    static int total_break_time = 0;
     static int session = 1;
 
     if (reset) {
@@ -1000,19 +1055,15 @@ void break_state(bool reset=false){
       if (pomodoro_mode==true){
         pomodoro_mode=false;
       }
-      NeoPixel.clear();
-      NeoPixel.show();
+      ring_clear();
+      ring_show();
       return;}
 
-    if (paused) {
-      oled.clearDisplay();
-      oled.setTextColor(WHITE);
-      oled.setCursor(0,40);
-      oled.setTextSize(5);
-      oled.setFont(&Picopixel);
-      oled.print("PAUSED!");
-      oled.display();
-      return;}
+    ScreenModel screen = make_screen(knob.state, 0, 0);
+    screen.paused = knob.paused;
+    screen.timers = timers_count();
+    show_screen(screen);
+    if (knob.paused) return;
     
     if (temp_break_time == -1) {
         if(pomodoro_mode){
@@ -1022,68 +1073,64 @@ void break_state(bool reset=false){
             temp_break_time=MIN_BREAK_TIME;
           }
         }
-        else{temp_break_time = break_time;}
-        NeoPixel.clear();
+        else{temp_break_time = knob.break_time;}
+        total_break_time = temp_break_time;
+        ring_clear();
         int pixels_to_show = floor(temp_break_time / BREAK_PIXELS_PER_MINS);
         for (int pixel = 0; pixel < pixels_to_show; pixel++) {
             if (pixel<= floor(MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(BREAK_MIN_COLOR));}
+              ring_set(pixel, BREAK_MIN_COLOR);}
             else{
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(BREAK_MIN_COLOR));}
-              NeoPixel.show();
-              delay(LIGHT_DELAY);
+              ring_set(pixel, BREAK_MIN_COLOR);}
+              ring_show();
+              clock_delay(LIGHT_DELAY);
         }
-        last = rtc.now();
+        last = clock_now();
         
     }
 
     
     
-    NeoPixel.clear();
     int pixels_to_show = floor(temp_break_time / BREAK_PIXELS_PER_MINS);
-    for (int pixel = 0; pixel < pixels_to_show; pixel++) {
-        if (pixel<= floor(MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS)-1){
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(BREAK_MIN_COLOR));}
-        else{
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(BREAK_MIN_COLOR));}  
-    }
-    NeoPixel.show();
+    ring_bar(pixels_to_show, MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS, BREAK_MIN_COLOR, BREAK_MIN_COLOR);
+    ring_timer_flags();
+    ring_show();
     
 
     
-    DateTime now = rtc.now();
+    DateTime now = clock_now();
     long diffSeconds = now.unixtime() - last.unixtime();
     if (diffSeconds >= 1) {   
         last = now;
         temp_break_time -= BREAK_PIXELS_PER_MINS;
+        stats_day(now.unixtime()); // midnight during a break
     }
 
+    if (temp_break_time > 0) show_progress(temp_break_time, total_break_time, now.unixtime() - last.unixtime());
+
     if (temp_break_time <= 0) {
         temp_break_time = -1; 
-        NeoPixel.clear();
-        NeoPixel.show();
+        ring_clear();
+        ring_show();
 
         
 
-        if (session==cycle){
+        if (session==knob.cycle){
           pomodoro_mode=false;
           session=1;
-          
+          piezo_play(melody_alarm, PIEZO_ALARM, 3); // the whole pomodoro is over
 
 
-          for (int i=0; i<NUM_PIXELS; i++){
-            NeoPixel.setPixelColor(i, NeoPixel.Color(CYCLE_MIN_COLOR)); //completion state
-            NeoPixel.show();
-            delay(LIGHT_DELAY);
-          }
+          ring_sweep();
 
-          currentState=STATE_IDLE;
+          knob.state=STATE_IDLE;
         }
 
-        else if(session<cycle){
-          delay(100);
+        else if(session<knob.cycle){
+          piezo_play(melody_break_done, PIEZO_CHIME, 1);
+          clock_delay(100);
           session++;
-          currentState = STATE_STUDY;
+          knob.state = STATE_STUDY;
     }
   }
 }
@@ -1092,52 +1139,45 @@ void break_state(bool reset=false){
 void timer_state(bool reset=false) {
     static DateTime last;
     static int temp_timer_time = -1;
+    static int total_timer_time = 0;
 
     if (reset) {
       temp_timer_time = -1;
-      NeoPixel.clear();
-      NeoPixel.show();
+      ring_clear();
+      ring_show();
       return;}
 
-    if (paused) {
-      oled.clearDisplay();
-      oled.setTextColor(WHITE);
-      oled.setCursor(0,40);
-      oled.setTextSize(5);
-      oled.setFont(&Picopixel);
-      oled.print("PAUSED!");
-      oled.display();
-      return;}
+    ScreenModel screen = make_screen(knob.state, 0, 0);
+    screen.paused = knob.paused;
+    screen.timers = timers_count();
+    show_screen(screen);
+    if (knob.paused) return;
 
     if (temp_timer_time == -1) {
-        temp_timer_time = timer_time;
-        NeoPixel.clear();
+        temp_timer_time = knob.timer_time;
+        total_timer_time = temp_timer_time;
+        ring_clear();
         int pixels_to_show = floor(temp_timer_time / TIMER_PIXELS_PER_MINS);
         for (int pixel = 0; pixel < pixels_to_show; pixel++) {
             if (pixel<= floor(MIN_TIMER_TIME / TIMER_PIXELS_PER_MINS)-1){
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(TIMER_MIN_COLOR));}
+              ring_set(pixel, TIMER_MIN_COLOR);}
             else{
-              NeoPixel.setPixelColor(pixel, NeoPixel.Color(TIMER_ADDITIONAL_TIME));}
+              ring_set(pixel, TIMER_ADDITIONAL_TIME);}
 
-            NeoPixel.show();
-            delay(LIGHT_DELAY);
+            ring_show();
+            clock_delay(LIGHT_DELAY);
         }  
-        last = rtc.now();
+        last = clock_now();
     }
+    scrub(&temp_timer_time, &total_timer_time, TIMER_PIXELS_PER_MINS, MIN_TIMER_TIME, MAX_TIMER_TIME);
 
-    
-    NeoPixel.clear();
     int pixels_to_show = floor(temp_timer_time / TIMER_PIXELS_PER_MINS);
-    for (int pixel = 0; pixel < pixels_to_show; pixel++) {
-        if (pixel<= floor(MIN_TIMER_TIME / TIMER_PIXELS_PER_MINS)-1){
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(TIMER_MIN_COLOR));}
-        else{
-          NeoPixel.setPixelColor(pixel, NeoPixel.Color(TIMER_ADDITIONAL_TIME));}        
-    }
-    NeoPixel.show();
+    ring_bar(pixels_to_show, MIN_TIMER_TIME / TIMER_PIXELS_PER_MINS, TIMER_MIN_COLOR, TIMER_ADDITIONAL_TIME);
+    ring_timer_flags();
+    ring_show();
     
 
-    DateTime now = rtc.now();
+    DateTime now = clock_now();
     long diffSeconds = now.unixtime() - last.unixtime();
     
     if (diffSeconds >= 5) {   
@@ -1145,48 +1185,205 @@ void timer_state(bool reset=false) {
         temp_timer_time -= TIMER_PIXELS_PER_MINS;
     }
 
+    if (temp_timer_time > 0) show_progress(temp_timer_time, total_timer_time, now.unixtime() - last.unixtime());
+
     
     if (temp_timer_time <= 0) {
         temp_timer_time = -1;
-        NeoPixel.clear();
-        for (int i=0; i<NUM_PIXELS; i++){
-            NeoPixel.setPixelColor(i, NeoPixel.Color(CYCLE_MIN_COLOR)); //completion state
-            NeoPixel.show();
-            delay(LIGHT_DELAY);
-          }
-        currentState = STATE_IDLE; 
+        piezo_play(melody_alarm, PIEZO_ALARM, 3);
+        ring_clear();
+        ring_sweep();
+        knob.state = STATE_IDLE; 
     }
 }
 
+// the phase program from EEPROM, see program.h. Each phase gets the ring
+// bar and the dial of the state it stands for
+void program_state(bool reset=false) {
+    static uint8_t credited = 0; // minutes of this study phase already in the stats
+    if (reset) {
+      program_stop();
+      stats_save();
+      credited = 0;
+      ring_clear();
+      ring_show();
+      return;}
+
+    ScreenModel screen = make_screen(knob.state, 0, 0);
+    screen.paused = knob.paused;
+    screen.timers = timers_count();
+    show_screen(screen);
+
+    unsigned long now = clock_millis();
+    if (!program_running() && !program_start(now)) {
+        Serial.println("program: none stored");
+        knob.state = STATE_IDLE;
+        return;
+    }
+
+    unsigned long minute = SECONDS_PER_MIN * 1000UL;
+    Phase was = program_phase();
+    uint8_t event = program_poll(now, knob.paused);
+    if (was.op == OP_STUDY) { // minute by minute like study_state(), a stop keeps what was done
+        uint8_t done = event == PROGRAM_RUNNING ? (was.minutes * minute - program_left(now)) / minute : was.minutes;
+        if (done > credited) {
+            stats_focus(clock_now().unixtime(), done - credited);
+            credited = done;
+        }
+    }
+    if (event != PROGRAM_RUNNING) {
+        if (was.op == OP_STUDY) stats_save();
+        credited = 0;
+    }
+    if (event == PROGRAM_DONE) {
+        piezo_play(melody_alarm, PIEZO_ALARM, 3);
+        ring_clear();
+        ring_show();
+        knob.state = STATE_IDLE;
+        return;
+    }
+    if (event == PROGRAM_NEXT) {
+        piezo_play(was.op == OP_STUDY ? melody_study_done : melody_break_done, PIEZO_CHIME, 1);
+    }
+    if (knob.paused) return;
+
+    Phase phase = program_phase();
+    unsigned long left = program_left(now);
+    int mins = (left + minute - 1) / minute;
+
+    if (phase.op == OP_STUDY) {
+        int pixels = (mins + STUDY_PIXELS_PER_MINS - 1) / STUDY_PIXELS_PER_MINS;
+        ring_bar(pixels, MIN_STUDY_TIME / STUDY_PIXELS_PER_MINS, STUDY_MIN_COLOR, STUDY_ADDITIONAL_TIME);
+    }
+    else if (phase.op == OP_BREAK) {
+        ring_bar(mins / BREAK_PIXELS_PER_MINS, MIN_BREAK_TIME / BREAK_PIXELS_PER_MINS, BREAK_MIN_COLOR, BREAK_MIN_COLOR);
+    }
+    else {
+        ring_bar(mins / CYCLE_PIXELS_PER_MINS, MIN_BREAK_TIME / CYCLE_PIXELS_PER_MINS, CYCLE_MIN_COLOR, CYCLE_ADDITIONAL_TIME);
+    }
+    ring_timer_flags();
+    ring_show();
+
+    dial_update(left * 60 / minute, phase.minutes * 60UL);
+}
+
+void side_timer_done(const KnobTimer *t){
+  piezo_play(melody_alarm, PIEZO_ALARM, 2);
+  // the PC owns Serial and the ring while mirroring, the beep has to do
+  if (knob.state == STATE_MIRROR) return;
+
+  Serial.print("side timer done: ");
+  Serial.println(t->name);
+  ring_clear();
+  ring_sweep();
+
+  // config screens only draw what changed, make them start over
+  invalidate_view();
+  if (knob.state == STATE_CONFIG_STUDY) config_study_state(true);
+  else if (knob.state == STATE_CONFIG_BREAK) config_break_state(true);
+  else if (knob.state == STATE_CONFIG_CYCLE) config_cycle_state(true);
+  else if (knob.state == STATE_CONFIG_TIMER) config_timer_state(true);
+}
+
+void enter_state(State next){
+  switch (knob.state) {
+    case STATE_CONFIG_STUDY: config_study_state(true); break;
+    case STATE_CONFIG_BREAK: config_break_state(true); break;
+    case STATE_CONFIG_CYCLE: config_cycle_state(true); break;
+    case STATE_CONFIG_TIMER: config_timer_state(true); break;
+    case STATE_STUDY: study_state(true); break;
+    case STATE_BREAK: break_state(true); break;
+    case STATE_TIMER: timer_state(true); break;
+    case STATE_PROGRAM: program_state(true); break;
+    default: break;
+  }
+  knob.paused = false;
+  knob.state = next;
+  knob.scrub = 0;
+  invalidate_view(); // also when next is the state we were in
+}
+
+static void boot_ram_report(){
+  ram_report(Serial);
+}
+
+// not needed for the first frame, loop() runs these one per pass
+static void (*const deferred_init[])() PROGMEM = {
+  perf_pin_bench,      // no-op unless -DPIN_BENCH
+  encoder_bench_begin, // no-op unless -DENCODER_BENCH
+  piezo_bench,         // no-op unless -DTONE_BENCH
+  schedule_begin,      // reads the EEPROM table and the RTC
+  stats_save,          // the rollover stats_begin() did in RAM, ~3.4 ms per EEPROM byte
+  boot_ram_report,     // ~250 chars, blocks for a while at 9600 baud
+};
+
 void setup() {
-  Serial.begin(9600);
-  lastCLKstate = digitalRead(ENCODER_CLK); 
-  NeoPixel.begin();  
-  Wire.begin();
-  oled.begin(SSD1306_SWITCHCAPVCC, 0x3c);
+  boot_mark(BOOT_SETUP);
+  Serial.begin(SERIAL_BAUD);
+  boot_mark(BOOT_SERIAL);
+  i2c_begin(); // timeouts on before the first transfer
+  oled.begin(SSD1306_SWITCHCAPVCC, OLED_ADDRESS); // does Wire.begin() too
+  boot_mark(BOOT_DISPLAY);
   rtc.begin();
-  pinMode(ENCODER_CLK, INPUT_PULLUP); 
-  pinMode(ENCODER_DT, INPUT_PULLUP);
-  pinMode(ENCODER_BUTTON, INPUT_PULLUP);
-  attachInterrupt(digitalPinToInterrupt(ENCODER_CLK), updateEncoder, CHANGE);
+  boot_mark(BOOT_RTC);
+  ring_begin();
+  piezo_begin();
+  EncoderClk::input_pullup();
+  EncoderDt::input_pullup();
+  EncoderButton::input_pullup();
+  knob.clk = EncoderClk::read();
+#ifndef TRACE_REPLAY
+  interrupt_on_change<EncoderClk>();
+#endif
+  trace_begin(); // sets the virtual clock, before anything reads the time
+  brightness_poll(); // the first frame already at the hour's level
+  boot_mark(BOOT_INPUT);
   //oled.setFont(&Org_01);
+  stats_begin(); // the clock shows them, so before the first frame
+  idle_state(); // first frame: the clock, memoized so loop() won't redraw it
+  boot_mark(BOOT_FRAME);
+  perf_reset();
 }
 
 void loop() {
-
+  if (!trace_poll()) return; // replay finished
+  boot_poll(deferred_init, sizeof(deferred_init) / sizeof(deferred_init[0]));
+
+  perf_loop_begin();
+  ring_bench(); // no-op unless -DLED_EDGE_BENCH
+  ring_poll();
+  brightness_poll();
+  encoder_bench_poll();
+  ram_poll();
+  if (knob.state != STATE_MIRROR) shell_poll(); // mirror_poll() owns Serial then
   int buttonEvent = checkButton(); 
-  if (currentState == STATE_STUDY || currentState == STATE_BREAK || currentState == STATE_TIMER) {
+  if (buttonEvent && piezo_playing()) {
+    piezo_stop();    // a press while it beeps only silences it
+    buttonEvent = 0;
+  }
+
+  static uint8_t lastState = STATE_IDLE;
+  if (knob.state != lastState) {
+    invalidate_view(); // new screen, nothing on the oled/ring belongs to it yet
+    lastState = knob.state;
+  }
+  if (i2c_recovered(I2C_OLED)) oled_recover();
+
+  const KnobTimer *done = timers_poll(clock_millis());
+  if (done) side_timer_done(done);
+
+  if (knob.state == STATE_STUDY || knob.state == STATE_BREAK || knob.state == STATE_TIMER || knob.state == STATE_PROGRAM) {
       if (buttonEvent == 1) {   // short press
-          paused = !paused;     // toggle pause
+          knob.paused = !knob.paused;     // toggle pause
       }
   }
 
-  switch (currentState) {
+  switch (knob.state) {
     case STATE_IDLE:
       idle_state();
       if(buttonEvent==2){
         pomodoro_mode=true;
-        currentState=STATE_CONFIG_CYCLE;
+        knob.state=STATE_CONFIG_CYCLE;
       }
       break;
 
@@ -1202,15 +1399,29 @@ void loop() {
       config_cycle_state();  
       if (buttonEvent == 2) {
         config_cycle_state(true);
-        currentState = STATE_STUDY;
+        knob.state = STATE_STUDY;
       }
       break;
     
     case STATE_CONFIG_TIMER:
       config_timer_state();
+      if (buttonEvent == 1) {
+        // short press: run it as a side timer and go back to the clock
+        // numbered in start order, not by how many run, so a name stays unique while
+        // its timer runs and "cancel" hits the right one
+        static uint8_t started = 0;
+        char name[TIMER_NAME_LEN + 1];
+        sprintf(name, "T%u", ++started);
+        if (timers_add(name, clock_millis() + knob.timer_time * SECONDS_PER_MIN * 1000UL)) {
+          Serial.print("side timer started: ");
+          Serial.println(name);
+        }
+        config_timer_state(true);
+        knob.state = STATE_IDLE;
+      }
       if (buttonEvent == 2) {
         config_timer_state(true);
-        currentState = STATE_TIMER;
+        knob.state = STATE_TIMER;
       }
       break;
 
@@ -1218,7 +1429,7 @@ void loop() {
       timer_state();
       if (buttonEvent == 2) {
         timer_state(true);
-        currentState = STATE_IDLE;
+        knob.state = STATE_IDLE;
       }
       break;
 
@@ -1226,7 +1437,7 @@ void loop() {
       study_state();
       if (buttonEvent == 2) {
         study_state(true);
-        currentState = STATE_IDLE;
+        knob.state = STATE_IDLE;
       }
       break;
 
@@ -1234,9 +1445,26 @@ void loop() {
       break_state();
       if (buttonEvent == 2) {
         break_state(true);
-        currentState = STATE_IDLE;
+        knob.state = STATE_IDLE;
+      }
+      break;
+
+    case STATE_PROGRAM:
+      program_state();
+      if (buttonEvent == 2) {
+        program_state(true);
+        knob.state = STATE_IDLE;
+      }
+      break;
+
+    case STATE_MIRROR:
+      if (!mirror_poll() || buttonEvent == 2) {
+        mirror_end(SERIAL_BAUD);
+        mirror_report(Serial);
+        knob.state = STATE_IDLE;
       }
       break;
 
     }
-}
\ No newline at end of file
+  perf_loop_end();
+}
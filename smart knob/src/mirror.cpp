@@ -0,0 +1,198 @@
+#include "mirror.h"
+#include <util/crc16.h>
+#include "display.h"
+#include "knob.h"
+#include "ring.h"
+
+#ifdef __AVR__
+static_assert(sizeof(LedRun) == 5, "'L' frames carry runs as 5 bytes: end (little endian), r, g, b");
+#endif
+
+enum RxPhase { RX_TYPE, RX_HEADER, RX_PAYLOAD, RX_CRC, RX_DONE, RX_BAD };
+
+// COBS decoder
+static uint8_t cobsLeft = 0;  // data bytes left in the current block
+static bool cobsZero = false; // the block was short, a 0 comes before the next
+
+// frame parser, fed the decoded bytes
+static uint8_t phase = RX_TYPE;
+static uint8_t type;
+static uint8_t header[3];
+static uint8_t headerPos;
+static uint8_t headerLen;
+static uint8_t *dest;
+static uint16_t destLeft;
+static uint8_t crcLeft;
+static uint16_t crc;
+static uint16_t frameBytes;   // on the wire, so far
+static bool ringEdit;         // the payload goes into the ring's run table
+
+static bool exitRequested = false;
+
+static unsigned long startMs;
+static unsigned long frames = 0;  // 'F' frames
+static unsigned long wireBytes = 0;
+static unsigned long payloadBytes = 0;
+static unsigned long badFrames = 0;
+
+static void rx_reset() {
+  cobsLeft = 0;
+  cobsZero = false;
+  phase = RX_TYPE;
+  crc = 0xFFFF;
+  frameBytes = 0;
+  ringEdit = false;
+}
+
+void mirror_begin(unsigned long baud) {
+  Serial.flush();
+  Serial.begin(baud);
+
+  oled.clearDisplay();
+  oled_show();
+  ring_manual(true); // no soft-start resends in the middle of a host frame
+  ring_clear();
+  ring_show();
+
+  rx_reset();
+  exitRequested = false;
+  startMs = millis();
+  frames = wireBytes = payloadBytes = badFrames = 0;
+}
+
+void mirror_end(unsigned long baud) {
+  if (ringEdit) ring_commit(0); // left in the middle of an 'L' frame
+  ring_manual(false);
+  rx_reset();
+  Serial.flush();
+  Serial.begin(baud);
+}
+
+// the header is complete: where its payload goes, if anywhere
+static uint8_t start_payload() {
+  if (type == 'P') {
+    uint8_t page = header[0], col = header[1], len = header[2];
+    if (page >= oled.height() / 8 || len == 0 || col + len > oled.width()) return RX_BAD;
+    dest = oled.getBuffer() + page * oled.width() + col;
+    destLeft = len;
+  }
+  else { // 'L'
+    if (header[0] == 0 || header[0] > RING_MAX_RUNS) return RX_BAD;
+    dest = (uint8_t *)ring_edit();
+    ringEdit = true;
+    destLeft = header[0] * sizeof(LedRun);
+  }
+  return RX_PAYLOAD;
+}
+
+// one decoded byte
+static void rx_byte(uint8_t c) {
+  crc = _crc_ccitt_update(crc, c);
+
+  switch (phase) {
+    case RX_TYPE:
+      type = c;
+      headerPos = 0;
+      headerLen = c == 'P' ? 3 : c == 'L' ? 1 : 0;
+      crcLeft = 2;
+      if (headerLen) phase = RX_HEADER;
+      else phase = c == 'F' || c == 'X' ? RX_CRC : RX_BAD;
+      break;
+
+    case RX_HEADER:
+      header[headerPos++] = c;
+      if (headerPos == headerLen) phase = start_payload();
+      break;
+
+    case RX_PAYLOAD:
+      *dest++ = c;
+      if (--destLeft == 0) phase = RX_CRC;
+      break;
+
+    case RX_CRC:
+      if (--crcLeft == 0) phase = RX_DONE;
+      break;
+
+    default: // RX_DONE with bytes left over, or RX_BAD
+      phase = RX_BAD;
+      break;
+  }
+}
+
+// a complete frame with a good CRC, false if its content makes no sense
+static bool apply() {
+  switch (type) {
+    case 'P': {
+      uint8_t y = header[0] * 8;
+      oled_show_rect(header[1], y, header[1] + header[2] - 1, y + 7);
+      payloadBytes += header[2];
+      break;
+    }
+    case 'L':
+      if (!ring_commit(header[0])) return false;
+      ring_show();
+      payloadBytes += header[0] * sizeof(LedRun);
+      break;
+    case 'F':
+      frames++;
+      break;
+    case 'X':
+      exitRequested = true;
+      break;
+  }
+  return true;
+}
+
+static void rx_end() {
+  if (frameBytes == 1) return; // a lone 0, the host resyncing
+
+  // CRC-16/MCRF4XX over data and its own CRC leaves 0
+  if (phase == RX_DONE && crc == 0 && apply()) {
+    Serial.write(MIRROR_ACK);
+    return;
+  }
+  if (ringEdit) ring_commit(0); // hands the table back, cleared
+  badFrames++;
+  Serial.write(MIRROR_NAK);
+}
+
+bool mirror_poll() {
+  int n = Serial.available();
+  while (n-- > 0 && !exitRequested) {
+    uint8_t c = Serial.read();
+    wireBytes++;
+    frameBytes++;
+
+    if (c == 0) {
+      rx_end();
+      rx_reset();
+    }
+    else if (cobsLeft == 0) { // code byte
+      if (cobsZero) rx_byte(0);
+      cobsLeft = c - 1;
+      cobsZero = c != 0xFF;
+    }
+    else {
+      cobsLeft--;
+      rx_byte(c);
+    }
+  }
+  return !exitRequested;
+}
+
+void mirror_report(Print &out) {
+  unsigned long ms = millis() - startMs;
+  out.print(F("mirror frames: "));
+  out.println(frames);
+  out.print(F("mirror fps: "));
+  out.println(ms ? frames * 1000.0 / ms : 0.0, 1);
+  out.print(F("mirror payload/wire bytes: "));
+  out.print(payloadBytes);
+  out.print('/');
+  out.print(wireBytes);
+  out.print(F(" ("));
+  out.print(wireBytes ? payloadBytes * 100.0 / wireBytes : 0.0, 1);
+  out.println(F("%)"));
+  out.print(F("mirror bad frames: "));
+  out.println(badFrames);
+}
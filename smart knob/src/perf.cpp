@@ -0,0 +1,147 @@
+#include "perf.h"
+#include "pins.h"
+#include "knob.h"
+#include "transition.h"
+
+PerfStats perf;
+
+static unsigned long loopStart = 0;
+
+void perf_reset() {
+  memset(&perf, 0, sizeof(perf));
+  perf.loop_us_min = 0xFFFFFFFFUL;
+}
+
+void perf_loop_begin() {
+  loopStart = micros();
+}
+
+void perf_loop_end() {
+  unsigned long took = micros() - loopStart;
+  perf.loops++;
+  perf.loop_us_total += took;
+  if (took < perf.loop_us_min) perf.loop_us_min = took;
+  if (took > perf.loop_us_max) perf.loop_us_max = took;
+}
+
+void perf_oled_frame() {
+  perf.oled_frames++;
+  perf.i2c_bytes += OLED_FRAME_BYTES;
+}
+
+uint16_t perf_oled_rect(uint16_t bytes) {
+  // data goes out in 31 byte chunks, each with the address and a 0x40 control byte
+  uint16_t bus = OLED_RECT_OVERHEAD + bytes + (bytes + 30) / 31 * 2;
+  perf.oled_rects++;
+  perf.i2c_bytes += bus;
+  return bus;
+}
+
+void perf_oled_command() {
+  perf.i2c_bytes += OLED_COMMAND_BYTES;
+}
+
+void perf_led_frame(uint16_t bytes) {
+  perf.led_frames++;
+  perf.led_bytes += bytes;
+}
+
+void perf_rtc_read() {
+  perf.rtc_reads++;
+  perf.i2c_bytes += RTC_READ_BYTES;
+}
+
+void perf_report(Print &out) {
+  out.print(F("loops: "));
+  out.println(perf.loops);
+  if (perf.loops > 0) {
+    out.print(F("loop us min/avg/max: "));
+    out.print(perf.loop_us_min);
+    out.print('/');
+    out.print(perf.loop_us_total / perf.loops);
+    out.print('/');
+    out.println(perf.loop_us_max);
+  }
+  out.print(F("oled frames: "));
+  out.println(perf.oled_frames);
+  out.print(F("oled rects: "));
+  out.println(perf.oled_rects);
+  out.print(F("screens full/partial, draw us: "));
+  out.print(perf.screens_full);
+  out.print('/');
+  out.print(perf.screens_partial);
+  out.print(F(", "));
+  out.println(perf.screen_draw_us);
+  if (perf.oled_transitions > 0) {
+    // a software slide sends the whole frame on each of the same steps
+    out.print(F("oled slide i2c bytes avg/software: "));
+    out.print(perf.oled_transition_bytes / perf.oled_transitions);
+    out.print('/');
+    out.println((unsigned long)TRANSITION_STEPS * OLED_FRAME_BYTES);
+  }
+  out.print(F("led frames: "));
+  out.println(perf.led_frames);
+  out.print(F("rtc reads: "));
+  out.println(perf.rtc_reads);
+  out.print(F("i2c bytes: "));
+  out.println(perf.i2c_bytes);
+  out.print(F("led bytes: "));
+  out.println(perf.led_bytes);
+  out.print(F("led us: "));
+  out.println(perf.led_us);
+  out.print(F("led runs/dropped: "));
+  out.print(perf.led_runs);
+  out.print('/');
+  out.println(perf.led_runs_dropped);
+  out.print(F("led limited/peak mA: "));
+  out.print(perf.led_limited);
+  out.print('/');
+  out.println(perf.led_ma_peak);
+  out.print(F("encoder edges/missed: "));
+  out.print(perf.encoder_edges);
+  out.print('/');
+  out.println(perf.encoder_missed);
+  out.print(F("encoder cw/ccw: "));
+  out.print(perf.encoder_cw);
+  out.print('/');
+  out.println(perf.encoder_ccw);
+}
+
+#ifdef PIN_BENCH
+
+#define PIN_BENCH_READS 10000
+
+// cycles per call, loop overhead included in both so the difference is fair
+static unsigned long bench_cycles(unsigned long us) {
+  return us * (F_CPU / 1000000UL) / PIN_BENCH_READS;
+}
+
+void perf_pin_bench() {
+  volatile uint8_t sink = 0;
+
+  unsigned long start = micros();
+  for (uint16_t i = 0; i < PIN_BENCH_READS; i++) sink += digitalRead(4);
+  unsigned long slow = micros() - start;
+
+  start = micros();
+  for (uint16_t i = 0; i < PIN_BENCH_READS; i++) sink += Pin<4>::read();
+  unsigned long fast = micros() - start;
+
+  Serial.print(F("digitalRead cycles: "));
+  Serial.println(bench_cycles(slow));
+  Serial.print(F("Pin<N>::read cycles: "));
+  Serial.println(bench_cycles(fast));
+
+  // consistent copy of everything the encoder ISR touches
+  start = micros();
+  for (uint16_t i = 0; i < PIN_BENCH_READS; i++) sink += knob_snapshot().study_time;
+  Serial.print(F("knob_snapshot cycles: "));
+  Serial.println(bench_cycles(micros() - start));
+}
+
+#else
+
+void perf_pin_bench() {
+}
+
+#endif
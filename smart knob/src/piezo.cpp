@@ -0,0 +1,153 @@
+#include "piezo.h"
+#include "pins.h"
+#include "trace.h"
+
+const uint8_t melody_study_done[] PROGMEM = {
+  NOTE(P_E6, L4), NOTE(P_C6, L4), NOTE(P_G5, L8), PIEZO_END
+};
+
+const uint8_t melody_break_done[] PROGMEM = {
+  NOTE(P_G5, L4), NOTE(P_C6, L4), NOTE(P_E6, L8), PIEZO_END
+};
+
+const uint8_t melody_alarm[] PROGMEM = {
+  NOTE(P_A6, L3), NOTE(P_REST, L2), NOTE(P_A6, L3), NOTE(P_REST, L2), NOTE(P_A6, L3), NOTE(P_REST, L12), PIEZO_END
+};
+
+#ifdef LED_BACKEND_SPI
+
+// D11 is MOSI for the LED strip, there is no free Timer2 pin left
+void piezo_begin() {
+}
+
+bool piezo_play(const uint8_t *melody, uint8_t priority, uint8_t repeat) {
+  return false;
+}
+
+void piezo_stop() {
+}
+
+bool piezo_playing() {
+  return false;
+}
+
+#else
+
+typedef Pin<11> PiezoPin;
+
+// OCR2A per pitch at 16 MHz / 64 / 2, C5 = 523 Hz up to F#7 = 2960 Hz
+static const uint8_t pitch_ocr[31] PROGMEM = {
+  238, 224, 212, 200, 189, 178, 168, 158, 149, 141, 133, 126,
+  118, 112, 105, 99, 94, 88, 83, 79, 74, 70, 66, 62,
+  59, 55, 52, 49, 46, 44, 41
+};
+
+static const uint8_t length_units[8] PROGMEM = {1, 2, 3, 4, 6, 8, 12, 16};
+
+#define REST_OCR 124          // 1 kHz tick while silent, pin disconnected
+#define HALF_PERIODS_PER_UNIT(ocr) (7813 / ((ocr) + 1)) // 1/32 s of compare matches
+
+// touched by the ISR
+static const uint8_t *volatile melodyStart = NULL;
+static const uint8_t *volatile notePtr = NULL; // NULL = silent
+static volatile uint16_t ticksLeft = 0;
+static volatile uint8_t repeatsLeft = 0;        // 0 = forever
+static volatile uint8_t playingPriority = 0;
+
+static void timer_off() {
+  TIMSK2 = 0;
+  TCCR2A = 0;
+  TCCR2B = 0;
+  PiezoPin::low();
+  notePtr = NULL;
+  playingPriority = 0;
+}
+
+// loads the note at notePtr, wrapping or stopping at the end. ISR context
+static void next_note() {
+  uint8_t note = pgm_read_byte(notePtr);
+  if (note == PIEZO_END) {
+    if (repeatsLeft == 1) {
+      timer_off();
+      return;
+    }
+    if (repeatsLeft) repeatsLeft--;
+    notePtr = melodyStart;
+    note = pgm_read_byte(notePtr);
+  }
+  notePtr++;
+
+  uint8_t pitch = note >> 3;
+  uint8_t ocr = pitch ? pgm_read_byte(&pitch_ocr[pitch - 1]) : REST_OCR;
+  ticksLeft = HALF_PERIODS_PER_UNIT(ocr) * pgm_read_byte(&length_units[note & 7]);
+
+  // toggle OC2A for a note, leave the pin alone (low) for a rest
+  TCCR2A = pitch ? _BV(COM2A0) | _BV(WGM21) : _BV(WGM21);
+  OCR2A = ocr;
+  TCNT2 = 0; // a smaller OCR2A than the count would run to 255 first
+}
+
+ISR(TIMER2_COMPA_vect) {
+  if (--ticksLeft == 0) next_note();
+}
+
+void piezo_begin() {
+  PiezoPin::low();
+  PiezoPin::output();
+}
+
+bool piezo_play(const uint8_t *melody, uint8_t priority, uint8_t repeat) {
+  if (priority < playingPriority) return false;
+  if (TRACE_SKIP_OUTPUT) return true;
+
+  TIMSK2 = 0; // ISR off while the melody is swapped
+  melodyStart = melody;
+  notePtr = melody;
+  repeatsLeft = repeat;
+  playingPriority = priority;
+  next_note();
+  TIFR2 = _BV(OCF2A);
+  TCCR2B = _BV(CS22); // clk/64
+  TIMSK2 = _BV(OCIE2A);
+  return true;
+}
+
+void piezo_stop() {
+  timer_off();
+}
+
+bool piezo_playing() {
+  return playingPriority != 0; // one byte, notePtr could tear
+}
+
+#endif
+
+#if defined(TONE_BENCH) && !defined(LED_BACKEND_SPI)
+
+static const uint8_t melody_bench[] PROGMEM = {NOTE(P_Fs7, L16), PIEZO_END};
+
+// busy loop passes in 250 ms, whatever ISRs run meanwhile steal from it
+static unsigned long bench_spin() {
+  unsigned long passes = 0;
+  unsigned long start = micros();
+  while (micros() - start < 250000UL) passes++;
+  return passes;
+}
+
+void piezo_bench() {
+  unsigned long silent = bench_spin();
+  piezo_play(melody_bench, PIEZO_ALARM, 0);
+  unsigned long playing = bench_spin();
+  piezo_stop();
+
+  Serial.print(F("tone isr overhead at 2960 Hz: "));
+  Serial.print(100.0 * (silent - playing) / silent, 1);
+  Serial.println('%');
+}
+
+#else
+
+void piezo_bench() {
+}
+
+#endif
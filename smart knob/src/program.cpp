@@ -0,0 +1,198 @@
+#include "program.h"
+#include <EEPROM.h>
+#include <util/crc16.h>
+#include "knob.h"
+
+#define EE_LENGTH (EE_PROGRAM + 1)
+#define EE_CRC (EE_PROGRAM + 2)
+#define EE_CODE (EE_PROGRAM + 4)
+
+#define PC_STOPPED 0xFF
+
+// the interpreter
+static uint8_t pc = PC_STOPPED;  // byte offset of the running phase
+static unsigned long deadline;   // millis() it ends, or ms left while held
+static bool held = false;
+
+static const char kinds[] PROGMEM = "sbl"; // OP_STUDY.. as written
+
+static bool valid_phase(uint8_t op, uint8_t minutes) {
+  return op >= OP_STUDY && op <= OP_LONG_BREAK && minutes >= 1 && minutes <= PROGRAM_PHASE_MAX;
+}
+
+static uint8_t stored_length() {
+  if (EEPROM.read(EE_PROGRAM) != EE_PROGRAM_MAGIC) return 0;
+  uint8_t length = EEPROM.read(EE_LENGTH);
+  return length <= PROGRAM_MAX && length % 2 == 0 ? length : 0;
+}
+
+static Phase read_phase(uint8_t at) {
+  Phase p = {OP_END, 0};
+  if (at < stored_length()) EEPROM.get(EE_CODE + at, p);
+  return p;
+}
+
+bool program_valid() {
+  uint8_t length = stored_length();
+  if (length == 0) return false;
+
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i += 2) {
+    Phase p = read_phase(i);
+    if (!valid_phase(p.op, p.minutes)) return false;
+    crc = _crc_ccitt_update(crc, p.op);
+    crc = _crc_ccitt_update(crc, p.minutes);
+  }
+  uint16_t stored;
+  EEPROM.get(EE_CRC, stored);
+  return crc == stored;
+}
+
+static bool digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+static uint8_t number(const char **s) {
+  uint16_t n = 0;
+  while (digit(**s)) {
+    n = n * 10 + *(*s)++ - '0';
+    if (n > 255) n = 256; // out of range either way, don't wrap
+  }
+  return n > 255 ? 0 : n;
+}
+
+// text to bytecode in code[], the length in *length
+static uint8_t compile(const char *s, uint8_t *code, uint8_t *length) {
+  uint8_t len = 0;
+  int8_t group = -1; // where the open bracket's phases start
+
+  while (*s) {
+    if (*s == ' ') {
+      s++;
+    }
+    else if (*s == '(') {
+      if (group >= 0) return PROGRAM_BAD_SYNTAX; // one level only
+      group = len;
+      s++;
+    }
+    else if (*s == ')') {
+      if (group < 0 || s[1] != 'x') return PROGRAM_BAD_SYNTAX;
+      s += 2;
+      uint8_t times = number(&s);
+      uint8_t body = len - group;
+      if (times == 0 || body == 0) return PROGRAM_BAD_SYNTAX;
+      for (uint8_t i = 1; i < times; i++) {
+        if (len + body > PROGRAM_MAX) return PROGRAM_TOO_LONG;
+        memcpy(code + len, code + group, body);
+        len += body;
+      }
+      group = -1;
+    }
+    else if (digit(*s)) {
+      uint8_t minutes = number(&s);
+      uint8_t op = OP_END;
+      for (uint8_t k = 0; k < sizeof(kinds) - 1; k++) {
+        if (*s == pgm_read_byte(&kinds[k])) op = OP_STUDY + k;
+      }
+      if (op == OP_END) return PROGRAM_BAD_SYNTAX;
+      s++;
+      if (!valid_phase(op, minutes)) return PROGRAM_BAD_PHASE;
+      if (len + 2 > PROGRAM_MAX) return PROGRAM_TOO_LONG;
+      code[len++] = op;
+      code[len++] = minutes;
+    }
+    else {
+      return PROGRAM_BAD_SYNTAX;
+    }
+  }
+  if (group >= 0 || len == 0) return PROGRAM_BAD_SYNTAX;
+  *length = len;
+  return PROGRAM_OK;
+}
+
+uint8_t program_store(const char *source) {
+  uint8_t code[PROGRAM_MAX];
+  uint8_t length;
+  uint8_t result = compile(source, code, &length);
+  if (result != PROGRAM_OK) return result;
+
+  program_stop(); // it would read the new phases halfway through
+  uint16_t crc = 0xFFFF;
+  for (uint8_t i = 0; i < length; i++) {
+    crc = _crc_ccitt_update(crc, code[i]);
+    EEPROM.update(EE_CODE + i, code[i]);
+  }
+  EEPROM.put(EE_CRC, crc);
+  EEPROM.update(EE_LENGTH, length);
+  EEPROM.update(EE_PROGRAM, EE_PROGRAM_MAGIC);
+  return PROGRAM_OK;
+}
+
+void program_clear() {
+  program_stop();
+  EEPROM.update(EE_PROGRAM, 0xFF);
+}
+
+void program_print(Print &out) {
+  uint8_t length = stored_length();
+  for (uint8_t i = 0; i < length; i += 2) {
+    Phase p = read_phase(i);
+    if (i) out.print(' ');
+    out.print(p.minutes);
+    out.print(valid_phase(p.op, p.minutes) ? (char)pgm_read_byte(&kinds[p.op - OP_STUDY]) : '?');
+  }
+  out.println();
+}
+
+static void begin_phase(unsigned long now) {
+  deadline = now + read_phase(pc).minutes * (SECONDS_PER_MIN * 1000UL);
+}
+
+bool program_start(unsigned long now) {
+  if (!program_valid()) return false;
+  pc = 0;
+  held = false;
+  begin_phase(now);
+  return true;
+}
+
+void program_stop() {
+  pc = PC_STOPPED;
+}
+
+bool program_running() {
+  return pc != PC_STOPPED;
+}
+
+uint8_t program_poll(unsigned long now, bool hold) {
+  if (pc == PC_STOPPED) return PROGRAM_DONE;
+
+  if (hold != held) { // the deadline turns into the time left and back
+    deadline = hold ? deadline - now : deadline + now;
+    held = hold;
+  }
+  if (held || (long)(now - deadline) < 0) return PROGRAM_RUNNING;
+
+  pc += 2;
+  if (read_phase(pc).op == OP_END) {
+    pc = PC_STOPPED;
+    return PROGRAM_DONE;
+  }
+  begin_phase(deadline); // back to back, however late this poll was
+  return PROGRAM_NEXT;
+}
+
+Phase program_phase() {
+  return read_phase(pc);
+}
+
+uint8_t program_index() {
+  return pc / 2;
+}
+
+unsigned long program_left(unsigned long now) {
+  if (pc == PC_STOPPED) return 0;
+  if (held) return deadline;
+  long left = deadline - now;
+  return left > 0 ? left : 0;
+}
@@ -0,0 +1,62 @@
+#include "display.h"
+#include <RTClib.h>
+#include <Wire.h>
+#include "ram.h"
+#include "knob.h"
+#include "ring.h"
+
+extern RTC_DS1307 rtc;
+
+extern uint8_t _end;       // end of .bss
+extern uint8_t __stack;    // RAMEND
+extern char *__brkval;     // heap top, 0 until the first malloc
+extern char __heap_start;
+
+static char *heap_top() {
+  return __brkval ? __brkval : &__heap_start;
+}
+
+int ram_free() {
+  char top;
+  return &top - heap_top();
+}
+
+int ram_stack_unused() {
+  uint8_t *p = (uint8_t *)heap_top();
+  int unused = 0;
+  while (p <= &__stack && *p == STACK_CANARY) {
+    p++;
+    unused++;
+  }
+  return unused;
+}
+
+static void ram_line(Print &out, const __FlashStringHelper *name, int bytes) {
+  out.print(name);
+  out.println(bytes);
+}
+
+void ram_report(Print &out) {
+  ram_line(out, F("ram free: "), ram_free());
+  ram_line(out, F("ram never used by stack: "), ram_stack_unused());
+  ram_line(out, F("static (data+bss): "), (int)(&_end - (uint8_t *)RAMSTART));
+  ram_line(out, F("heap: "), (int)(heap_top() - &__heap_start));
+
+  // what each module holds, objects plus their malloc'd buffers
+  ram_line(out, F("  display: "), sizeof(oled) + oled.width() * ((oled.height() + 7) / 8));
+  ram_line(out, F("  leds: "), ring_ram());
+  ram_line(out, F("  rtc: "), sizeof(rtc));
+  ram_line(out, F("  wire: "), sizeof(Wire) + 5 * BUFFER_LENGTH); // Wire rx/tx + twi master/rx/tx
+  ram_line(out, F("  serial: "), sizeof(Serial));
+  ram_line(out, F("  knob state: "), sizeof(knob) + sizeof(knob_seq));
+}
+
+void ram_poll() {
+#ifdef RAM_REPORT_MS
+  static unsigned long lastReport = 0;
+  if (millis() - lastReport >= RAM_REPORT_MS) {
+    lastReport = millis();
+    ram_report(Serial);
+  }
+#endif
+}
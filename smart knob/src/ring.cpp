@@ -0,0 +1,313 @@
+#include <Adafruit_NeoPixel.h>
+#include "ring.h"
+#include "perf.h"
+#include "trace.h"
+#include "pins.h"
+#include "capture.h"
+#include "clock.h"
+
+static LedRun runs[RING_MAX_RUNS] = {{RING_PIXELS, 0, 0, 0}};
+static uint8_t runCount = 1;
+
+static uint8_t scale = 255;      // brightness the power limiter applies, 255 = full
+static uint8_t dim = 255;        // time-of-day level, already folded into scale
+static uint16_t frameMa = 0;     // estimated draw of the last frame sent
+static bool ramping = false;     // soft start still holding the ring below budget
+static unsigned long lastShow = 0;
+static_assert(RING_PIXELS * LED_IDLE_MA < LED_BUDGET_MA, "a dark ring alone would be over LED_BUDGET_MA");
+static bool manual = false;      // ring_manual(): only the caller's ring_show() sends
+static bool editing = false;     // ring_edit() handed the table out, it may be half written
+
+uint8_t ring_scaled(uint8_t v) {
+  return scale == 255 ? v : (uint16_t)v * (scale + 1) >> 8;
+}
+
+#ifdef LED_BACKEND_SPI
+
+// The USART in master SPI mode would give a double buffered stream, but on the
+// Nano it needs XCK0 (D4, the encoder button) as clock output and TXD (the
+// Serial link), so the plain SPI port is used instead.
+//
+// At 4 MHz one SPI bit is 250 ns and one WS2812 bit is four SPI bits:
+// 0 -> 1000 (250 ns high), 1 -> 1110 (750 ns high). Every SPI byte carries two
+// WS2812 bits and ends low, so the gap while the next byte is loaded, or an
+// ISR running in between, only stretches a low phase. That is fine as long
+// as it stays well under the ~50 us latch time.
+static const uint8_t ws2812_bits[4] = {0x88, 0x8E, 0xE8, 0xEE};
+
+static unsigned long lastLatch = 0;
+
+typedef Pin<10> SpiSs;
+typedef Pin<11> SpiMosi;
+typedef Pin<13> SpiSck;
+
+static inline void spi_put(uint8_t v) {
+  SPDR = v;
+  while (!(SPSR & _BV(SPIF)));
+}
+
+void ring_begin() {
+  SpiMosi::low();
+  SpiMosi::output();
+  SpiSck::output();
+  SpiSs::output(); // an input SS pulled low would drop the port out of master mode
+  SPCR = _BV(SPE) | _BV(MSTR);             // mode 0, MSB first, F_CPU/4
+  SPSR = 0;
+}
+
+uint16_t ring_ram() {
+  return sizeof(runs);
+}
+
+static void ring_write() {
+  uint16_t start = 0;
+
+  while (micros() - lastLatch < 300); // reset/latch time of the previous frame
+
+  for (uint8_t k = 0; k < runCount; k++) {
+    // encode the run's colour once, then repeat the 12 SPI bytes per pixel
+    uint8_t grb[3] = {ring_scaled(runs[k].g), ring_scaled(runs[k].r), ring_scaled(runs[k].b)};
+    uint8_t wire[12];
+    for (uint8_t i = 0; i < 3; i++) {
+      wire[i * 4] = ws2812_bits[grb[i] >> 6];
+      wire[i * 4 + 1] = ws2812_bits[(grb[i] >> 4) & 3];
+      wire[i * 4 + 2] = ws2812_bits[(grb[i] >> 2) & 3];
+      wire[i * 4 + 3] = ws2812_bits[grb[i] & 3];
+    }
+    for (uint16_t n = runs[k].end - start; n; n--) {
+      for (uint8_t i = 0; i < 12; i++) spi_put(wire[i]);
+    }
+    start = runs[k].end;
+  }
+  lastLatch = micros();
+}
+
+#else
+
+#if RING_PIXELS > 64
+#error "show() needs 3 bytes of RAM per LED, drive long strips with -DLED_BACKEND_SPI"
+#endif
+
+static Adafruit_NeoPixel NeoPixel(RING_PIXELS, Pin<RING_PIN>::number, NEO_GRB + NEO_KHZ800);
+
+void ring_begin() {
+  NeoPixel.begin();
+}
+
+uint16_t ring_ram() {
+  return sizeof(runs) + sizeof(NeoPixel) + RING_PIXELS * 3;
+}
+
+static void ring_write() {
+  uint8_t *p = NeoPixel.getPixels();
+  uint16_t start = 0;
+
+  for (uint8_t k = 0; k < runCount; k++) {
+    uint8_t g = ring_scaled(runs[k].g);
+    uint8_t r = ring_scaled(runs[k].r);
+    uint8_t b = ring_scaled(runs[k].b);
+    for (uint16_t n = runs[k].end - start; n; n--) {
+      *p++ = g;
+      *p++ = r;
+      *p++ = b;
+    }
+    start = runs[k].end;
+  }
+  NeoPixel.show();
+}
+
+#endif
+
+uint8_t ring_run_count() {
+  return runCount;
+}
+
+const LedRun *ring_runs() {
+  return runs;
+}
+
+void ring_clear() {
+  runs[0].end = RING_PIXELS;
+  runs[0].r = runs[0].g = runs[0].b = 0;
+  runCount = 1;
+}
+
+// run holding pixel i
+static uint8_t run_at(uint16_t i) {
+  uint8_t k = 0;
+  while (runs[k].end <= i) k++;
+  return k;
+}
+
+static void remove_runs(uint8_t k, uint8_t n) {
+  memmove(&runs[k], &runs[k + n], (runCount - k - n) * sizeof(LedRun));
+  runCount -= n;
+}
+
+static bool same_colour(const LedRun &a, const LedRun &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+// makes pixel i the first of a run, false if the table is full
+static bool split(uint16_t i) {
+  if (i == 0 || i >= RING_PIXELS) return true;
+  uint8_t k = run_at(i);
+  if (k > 0 && runs[k - 1].end == i) return true;
+  if (runCount == RING_MAX_RUNS) return false;
+
+  memmove(&runs[k + 1], &runs[k], (runCount - k) * sizeof(LedRun));
+  runs[k].end = i;
+  runCount++;
+  return true;
+}
+
+void ring_fill(uint16_t first, uint16_t count, uint8_t r, uint8_t g, uint8_t b) {
+  if (first >= RING_PIXELS || count == 0 || editing) return;
+  uint16_t end = count > RING_PIXELS - first ? RING_PIXELS : first + count;
+
+  if (!split(first) || !split(end)) {
+    perf.led_runs_dropped++;
+    return;
+  }
+
+  // runs a..z now cover exactly first..end-1, collapse them into a
+  uint8_t a = run_at(first);
+  uint8_t z = run_at(end - 1);
+  if (z > a) remove_runs(a + 1, z - a);
+  runs[a].end = end;
+  runs[a].r = r;
+  runs[a].g = g;
+  runs[a].b = b;
+
+  if (a + 1 < runCount && same_colour(runs[a], runs[a + 1])) {
+    runs[a].end = runs[a + 1].end;
+    remove_runs(a + 1, 1);
+  }
+  if (a > 0 && same_colour(runs[a - 1], runs[a])) {
+    runs[a - 1].end = runs[a].end;
+    remove_runs(a, 1);
+  }
+}
+
+void ring_set(uint16_t i, uint8_t r, uint8_t g, uint8_t b) {
+  ring_fill(i, 1, r, g, b);
+}
+
+LedRun *ring_edit() {
+  editing = true;
+  return runs;
+}
+
+bool ring_commit(uint8_t count) {
+  editing = false;
+  bool ok = count > 0 && count <= RING_MAX_RUNS && runs[count - 1].end == RING_PIXELS;
+  for (uint8_t k = 0; ok && k < count; k++) {
+    ok = runs[k].end > (k ? runs[k - 1].end : 0);
+  }
+
+  if (ok) runCount = count;
+  else ring_clear();
+  return ok;
+}
+
+// Draw of the current frame at full brightness, above the idle draw. One
+// multiply per run, so it runs on every refresh whatever the strip length.
+static uint16_t frame_load_ma() {
+  uint32_t sum = 0;
+  uint16_t start = 0;
+
+  for (uint8_t k = 0; k < runCount; k++) {
+    sum += (uint32_t)(runs[k].end - start) * (runs[k].r + runs[k].g + runs[k].b);
+    start = runs[k].end;
+  }
+  return sum * LED_MA_PER_CHANNEL / 255;
+}
+
+void ring_dim(uint8_t level) {
+  dim = level;
+}
+
+// Pick the scale for this frame, on top of the time-of-day level. Dimming takes effect right away, getting
+// brighter is limited to LED_RAMP_MA per frame so a full sweep does not hit
+// the rail in one step.
+static void ring_limit() {
+  uint16_t idle = RING_PIXELS * LED_IDLE_MA;
+  uint16_t load = frame_load_ma();
+  if (dim != 255) load = (uint32_t)load * (dim + 1) >> 8; // what the dimmed frame draws
+  uint16_t allowed = frameMa + LED_RAMP_MA;
+  bool capped = allowed < LED_BUDGET_MA;
+
+  if (!capped) allowed = LED_BUDGET_MA;
+  allowed = allowed > idle ? allowed - idle : 0;
+
+  uint16_t want = 255;
+  if (load > allowed) {
+    want = ((uint32_t)allowed << 8) / load;
+    if (want) want--; // rounds down, the estimate has to stay under allowed
+    perf.led_limited++;
+  }
+  ramping = capped && load > allowed;
+  scale = dim == 255 ? want : (uint16_t)want * (dim + 1) >> 8;
+
+  frameMa = idle + ((uint32_t)load * (want + 1) >> 8);
+  if (frameMa > perf.led_ma_peak) perf.led_ma_peak = frameMa;
+}
+
+void ring_show() {
+  if (editing) return;
+  perf_led_frame(RING_PIXELS * 3);
+  perf.led_runs += runCount;
+  ring_limit();
+  capture_led(frameMa);
+  lastShow = clock_millis(); // virtual in a replay, so the resends are the same every run
+  if (TRACE_SKIP_OUTPUT) return;
+
+  unsigned long start = micros();
+  ring_write();
+  perf.led_us += micros() - start;
+}
+
+void ring_manual(bool on) {
+  manual = on;
+}
+
+// Finish a soft start for frames the states only send once.
+void ring_poll() {
+  if (!manual && ramping && clock_millis() - lastShow >= LED_RAMP_MS) ring_show();
+}
+
+#ifdef LED_EDGE_BENCH
+
+void ring_bench() {
+  static unsigned long lastReport = 0;
+  static unsigned long lastEdges = 0;
+  static unsigned long lastMissed = 0;
+
+  // worst case for the encoder: a full frame going out back to back
+  ring_fill(0, RING_PIXELS, 10, 10, 10);
+  ring_show();
+
+  if (millis() - lastReport >= 5000) {
+    lastReport = millis();
+#ifdef LED_BACKEND_SPI
+    Serial.print(F("spi"));
+#else
+    Serial.print(F("neopixel"));
+#endif
+    Serial.print(F(" edges: "));
+    Serial.print(perf.encoder_edges - lastEdges);
+    Serial.print(F(" missed: "));
+    Serial.print(perf.encoder_missed - lastMissed);
+    Serial.print(F(" show us: "));
+    Serial.println(perf.led_frames ? perf.led_us / perf.led_frames : 0);
+    lastEdges = perf.encoder_edges;
+    lastMissed = perf.encoder_missed;
+  }
+}
+
+#else
+
+void ring_bench() {
+}
+
+#endif
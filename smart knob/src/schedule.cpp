@@ -0,0 +1,156 @@
+#include "schedule.h"
+#include <EEPROM.h>
+#include "clock.h"
+
+static_assert(sizeof(ScheduleEntry) == SCHEDULE_ENTRY_SIZE, "eeprom_map.h reserves SCHEDULE_ENTRY_SIZE per entry");
+
+#define EE_COUNT (EE_SCHEDULE + 1)
+#define EE_ENTRIES (EE_SCHEDULE + 2)
+
+static uint8_t count = 0;
+
+// the cache: next start time and which entry it belongs to
+static uint32_t nextAt = SCHEDULE_NONE;
+static uint8_t nextIndex = 0;
+static ScheduleEntry nextEntry;
+
+// where "now" falls in the week, worked out once per scan
+struct Today {
+  uint32_t midnight;
+  uint16_t minute;
+  uint8_t weekday;
+};
+
+static Today today_of(uint32_t now) {
+  DateTime t(now);
+  Today today;
+  today.minute = t.hour() * 60 + t.minute();
+  today.midnight = now - today.minute * 60UL - t.second();
+  today.weekday = t.dayOfTheWeek();
+  return today;
+}
+
+static uint16_t start_minute(const ScheduleEntry &e) {
+  return e.hour * 60 + e.minute;
+}
+
+static ScheduleEntry read_entry(uint8_t i) {
+  ScheduleEntry e;
+  EEPROM.get(EE_ENTRIES + i * sizeof(e), e);
+  return e;
+}
+
+// put() goes through update(), bytes that stay the same are not rewritten
+static void write_entry(uint8_t i, const ScheduleEntry &e) {
+  EEPROM.put(EE_ENTRIES + i * sizeof(e), e);
+}
+
+// first start of e after the minute we are in, SCHEDULE_NONE without days
+static uint32_t occurrence(const ScheduleEntry &e, const Today &today) {
+  for (uint8_t d = 0; d <= 7; d++) {
+    if (d == 0 && start_minute(e) <= today.minute) continue;
+    if (e.days & 1 << (today.weekday + d) % 7) {
+      return today.midnight + d * 86400UL + start_minute(e) * 60UL;
+    }
+  }
+  return SCHEDULE_NONE;
+}
+
+// day by day from today; the table is sorted, so the first entry that runs
+// on a day is that day's earliest and ends the scan
+static void find_next(uint32_t now) {
+  Today today = today_of(now);
+  nextAt = SCHEDULE_NONE;
+  for (uint8_t d = 0; d <= 7; d++) {
+    uint8_t bit = 1 << (today.weekday + d) % 7;
+    for (uint8_t i = 0; i < count; i++) {
+      ScheduleEntry e = read_entry(i);
+      if (!(e.days & bit) || (d == 0 && start_minute(e) <= today.minute)) continue;
+      nextAt = today.midnight + d * 86400UL + start_minute(e) * 60UL;
+      nextIndex = i;
+      nextEntry = e;
+      return;
+    }
+  }
+}
+
+void schedule_begin() {
+  if (EEPROM.read(EE_SCHEDULE) != EE_SCHEDULE_MAGIC || EEPROM.read(EE_COUNT) > SCHEDULE_MAX) {
+    EEPROM.update(EE_SCHEDULE, EE_SCHEDULE_MAGIC);
+    EEPROM.update(EE_COUNT, 0);
+  }
+  count = EEPROM.read(EE_COUNT);
+  schedule_rebuild();
+}
+
+uint8_t schedule_count() {
+  return count;
+}
+
+ScheduleEntry schedule_get(uint8_t i) {
+  return read_entry(i);
+}
+
+bool schedule_add(const ScheduleEntry &e) {
+  if (count >= SCHEDULE_MAX) return false;
+
+  // behind entries with the same start, so the older one keeps firing first
+  uint8_t pos = count;
+  while (pos > 0) {
+    ScheduleEntry prev = read_entry(pos - 1);
+    if (start_minute(prev) <= start_minute(e)) break;
+    write_entry(pos, prev);
+    pos--;
+  }
+  write_entry(pos, e);
+  EEPROM.update(EE_COUNT, ++count);
+
+  if (nextAt != SCHEDULE_NONE && pos <= nextIndex) nextIndex++;
+  uint32_t at = occurrence(e, today_of(clock_now().unixtime()));
+  if (at < nextAt) {
+    nextAt = at;
+    nextIndex = pos;
+    nextEntry = e;
+  }
+  return true;
+}
+
+bool schedule_remove(uint8_t i) {
+  if (i >= count) return false;
+
+  for (uint8_t j = i; j + 1 < count; j++) write_entry(j, read_entry(j + 1));
+  EEPROM.update(EE_COUNT, --count);
+
+  if (nextAt == SCHEDULE_NONE || i > nextIndex) return true;
+  if (i < nextIndex) nextIndex--;
+  else find_next(clock_now().unixtime()); // the cached one is gone
+  return true;
+}
+
+void schedule_clear() {
+  count = 0;
+  EEPROM.update(EE_COUNT, 0);
+  nextAt = SCHEDULE_NONE;
+}
+
+void schedule_rebuild() {
+  find_next(clock_now().unixtime());
+}
+
+uint32_t schedule_next_at() {
+  return nextAt;
+}
+
+int schedule_next_index() {
+  return nextAt == SCHEDULE_NONE ? -1 : nextIndex;
+}
+
+const ScheduleEntry *schedule_due(uint32_t now) {
+  if (now < nextAt) return NULL;
+
+  static ScheduleEntry due;
+  due = nextEntry;
+  bool missed = now - nextAt >= 60;
+  find_next(now); // strictly after this minute, it won't come up again today
+  return missed ? NULL : &due;
+}
@@ -0,0 +1,444 @@
+#include "shell.h"
+#include "knob.h"
+#include "clock.h"
+#include "perf.h"
+#include "ram.h"
+#include "timers.h"
+#include "schedule.h"
+#include "mirror.h"
+#include "stats.h"
+#include "i2c.h"
+#include "program.h"
+#include "brightness.h"
+
+struct ShellCommand {
+  char name[7];
+  void (*run)(char *args);
+};
+
+struct ShellMode {
+  char name[9];
+  uint8_t state;
+};
+
+static char line[SHELL_LINE_LEN + 1];
+static uint8_t lineLength = 0;
+static bool overflow = false;
+
+static unsigned long commandsRun = 0;
+static uint16_t parseUsLast = 0; // tokenizing + table lookup, without running it
+static uint16_t parseUsMax = 0;
+
+// cuts the next space separated word off *p, "" at the end of the line
+static char *next_word(char **p) {
+  char *s = *p;
+  while (*s == ' ') s++;
+  char *word = s;
+  while (*s && *s != ' ') s++;
+  if (*s) *s++ = 0;
+  *p = s;
+  return word;
+}
+
+// digits at *p, skipping anything else in front. false if there are none
+static bool next_number(char **p, long *value) {
+  char *s = *p;
+  while (*s && (*s < '0' || *s > '9')) s++;
+  if (!*s) return false;
+
+  long v = 0;
+  uint8_t digits = 0;
+  while (*s >= '0' && *s <= '9' && digits++ < 9) v = v * 10 + (*s++ - '0');
+  *p = s;
+  *value = v;
+  return true;
+}
+
+static const KnobSetting *find_setting(const char *name) {
+  for (uint8_t i = 0; i < settings_count; i++) {
+    if (strcmp_P(name, settings[i].name) == 0) return &settings[i];
+  }
+  return NULL;
+}
+
+// value from a snapshot, so a full get lists one consistent set even while
+// the knob is turning
+static void print_setting(const KnobSetting *s, const KnobState &k) {
+  KnobSetting setting;
+  memcpy_P(&setting, s, sizeof(setting));
+  Serial.print(setting.name);
+  Serial.print(F(" = "));
+  Serial.println(((const uint8_t *)&k)[setting.value - (volatile uint8_t *)&knob]);
+}
+
+// prints the allowed range when value is outside it
+static bool setting_allows(const KnobSetting *s, long value) {
+  KnobSetting setting;
+  memcpy_P(&setting, s, sizeof(setting));
+  if (value >= setting.min && value <= setting.max && (value - setting.min) % setting.step == 0) return true;
+
+  Serial.print(F("error: "));
+  Serial.print(setting.name);
+  Serial.print(' ');
+  Serial.print(setting.min);
+  Serial.print(F(".."));
+  Serial.print(setting.max);
+  Serial.print(F(" in steps of "));
+  Serial.println(setting.step);
+  return false;
+}
+
+static void cmd_help(char *args);
+
+static void cmd_get(char *args) {
+  char *name = next_word(&args);
+  KnobState k = knob_snapshot();
+  if (!*name) {
+    for (uint8_t i = 0; i < settings_count; i++) print_setting(&settings[i], k);
+    return;
+  }
+
+  const KnobSetting *s = find_setting(name);
+  if (!s) Serial.println(F("error: unknown setting"));
+  else print_setting(s, k);
+}
+
+static void cmd_set(char *args) {
+  const KnobSetting *s = find_setting(next_word(&args));
+  long value;
+  if (!s || !next_number(&args, &value)) {
+    Serial.println(F("usage: set <name> <value>"));
+    return;
+  }
+
+  if (!setting_allows(s, value)) return;
+
+  KnobSetting setting;
+  memcpy_P(&setting, s, sizeof(setting));
+  *setting.value = value;
+  // config screens draw incrementally, start them over on the new value
+  if (knob.state >= STATE_CONFIG_STUDY && knob.state <= STATE_CONFIG_TIMER) enter_state((State)knob.state);
+  print_setting(s, knob_snapshot());
+}
+
+static const ShellMode modes[] PROGMEM = {
+  {"study", STATE_STUDY},
+  {"break", STATE_BREAK},
+  {"timer", STATE_TIMER},
+  {"pomodoro", STATE_STUDY},
+  {"program", STATE_PROGRAM},
+};
+
+static void cmd_start(char *args) {
+  char *name = next_word(&args);
+  for (uint8_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+    if (strcmp_P(name, modes[i].name) == 0) {
+      if (pgm_read_byte(&modes[i].state) == STATE_PROGRAM && !program_valid()) {
+        Serial.println(F("error: no program, see prog"));
+        return;
+      }
+      enter_state((State)pgm_read_byte(&modes[i].state));
+      pomodoro_mode = strcmp_P(name, PSTR("pomodoro")) == 0;
+      Serial.println(F("ok"));
+      return;
+    }
+  }
+  Serial.println(F("usage: start study|break|timer|pomodoro|program"));
+}
+
+static void cmd_stop(char *args) {
+  enter_state(STATE_IDLE);
+  Serial.println(F("ok"));
+}
+
+static void cmd_pause(char *args) {
+  if (knob.state != STATE_STUDY && knob.state != STATE_BREAK && knob.state != STATE_TIMER && knob.state != STATE_PROGRAM) {
+    Serial.println(F("error: nothing running"));
+    return;
+  }
+  knob.paused = !knob.paused;
+  Serial.println(knob.paused ? F("paused") : F("running"));
+}
+
+static void print_2(uint8_t v, char after) {
+  if (v < 10) Serial.print('0');
+  Serial.print(v);
+  if (after) Serial.print(after);
+}
+
+static void cmd_time(char *args) {
+  long v[6];
+  uint8_t n = 0;
+  while (n < 6 && next_number(&args, &v[n])) n++;
+
+  if (n == 6) {
+    if (v[0] < 2000 || v[0] > 2099 || v[1] < 1 || v[1] > 12 || v[2] < 1 || v[2] > 31 ||
+        v[3] > 23 || v[4] > 59 || v[5] > 59) {
+      Serial.println(F("error: bad date"));
+      return;
+    }
+    clock_set(DateTime(v[0], v[1], v[2], v[3], v[4], v[5]).unixtime());
+    schedule_rebuild(); // the cached next start was relative to the old time
+  }
+  else if (n) {
+    Serial.println(F("usage: time [Y M D h m s]"));
+    return;
+  }
+
+  DateTime now = clock_now();
+  Serial.print(now.year());
+  Serial.print('-');
+  print_2(now.month(), '-');
+  print_2(now.day(), ' ');
+  print_2(now.hour(), ':');
+  print_2(now.minute(), ':');
+  print_2(now.second(), 0);
+  Serial.println();
+}
+
+// day letters Monday first, like people write weeks: MTWTF--
+static const char week[] PROGMEM = "MTWTFSS";
+
+static void print_entry(uint8_t i, const ScheduleEntry &e) {
+  Serial.print(i);
+  Serial.print(' ');
+  for (uint8_t k = 0; k < 7; k++) {
+    Serial.print(e.days & 1 << (k + 1) % 7 ? (char)pgm_read_byte(&week[k]) : '-');
+  }
+  Serial.print(' ');
+  print_2(e.hour, ':');
+  print_2(e.minute, ' ');
+  if (e.days & SCHEDULE_TIMER) {
+    Serial.print(F("timer "));
+    Serial.println(e.work);
+    return;
+  }
+  Serial.print(F("pomodoro "));
+  Serial.print(e.work);
+  Serial.print(' ');
+  Serial.print(e.rest >> 4);
+  Serial.print(' ');
+  Serial.println(e.rest & 15);
+}
+
+static void sched_list() {
+  for (uint8_t i = 0; i < schedule_count(); i++) print_entry(i, schedule_get(i));
+
+  int next = schedule_next_index();
+  if (next < 0) {
+    Serial.println(F("next: none"));
+    return;
+  }
+  Serial.print(F("next: "));
+  Serial.print(next);
+  Serial.print(F(" in "));
+  Serial.print((schedule_next_at() - clock_now().unixtime() + 59) / 60);
+  Serial.println(F(" min"));
+}
+
+// add <days> <hh:mm> pomodoro <study> <break> <cycles> | timer <minutes>
+static void sched_add(char *args) {
+  char *days = next_word(&args);
+  long hour = 0, minute = 0; // go into e even when the parse failed
+  bool ok = strlen(days) == 7 && next_number(&args, &hour) && next_number(&args, &minute) &&
+            hour < 24 && minute < 60;
+
+  ScheduleEntry e = {0, (uint8_t)hour, (uint8_t)minute, 0, 0};
+  for (uint8_t k = 0; ok && k < 7; k++) {
+    if (days[k] != '-') e.days |= 1 << (k + 1) % 7;
+  }
+
+  char *mode = next_word(&args);
+  long work, rest, cycles;
+  if (ok && strcmp_P(mode, PSTR("timer")) == 0 && next_number(&args, &work)) {
+    if (!setting_allows(find_setting("timer"), work)) return;
+    e.days |= SCHEDULE_TIMER;
+    e.work = work;
+  }
+  else if (ok && strcmp_P(mode, PSTR("pomodoro")) == 0 && next_number(&args, &work) &&
+           next_number(&args, &rest) && next_number(&args, &cycles)) {
+    if (!setting_allows(find_setting("study"), work) || !setting_allows(find_setting("break"), rest) ||
+        !setting_allows(find_setting("cycle"), cycles)) return;
+    e.work = work;
+    e.rest = rest << 4 | cycles; // fits, start_scheduled() asserts the maxima are <= 15
+  }
+  else {
+    Serial.println(F("usage: sched add MTWTF-- hh:mm pomodoro <study> <break> <cycles> | timer <min>"));
+    return;
+  }
+
+  if (!schedule_add(e)) Serial.println(F("error: schedule full"));
+  else sched_list();
+}
+
+static void cmd_sched(char *args) {
+  char *sub = next_word(&args);
+  long i;
+  if (!*sub) sched_list();
+  else if (strcmp_P(sub, PSTR("add")) == 0) sched_add(args);
+  else if (strcmp_P(sub, PSTR("del")) == 0 && next_number(&args, &i)) {
+    if (!schedule_remove(i)) Serial.println(F("error: no such entry"));
+    else sched_list();
+  }
+  else if (strcmp_P(sub, PSTR("clear")) == 0) {
+    schedule_clear();
+    Serial.println(F("ok"));
+  }
+  else Serial.println(F("usage: sched [add ...|del <n>|clear]"));
+}
+
+static void cmd_mirror(char *args) {
+  long baud = MIRROR_BAUD;
+  next_number(&args, &baud);
+  Serial.println(F("ok"));
+  enter_state(STATE_MIRROR);
+  mirror_begin(baud);
+}
+
+// "prog" lists the stored phase program, "prog clear" drops it and anything
+// else is a new one, see program.h
+static void cmd_prog(char *args) {
+  while (*args == ' ') args++;
+  if (strcmp_P(args, PSTR("clear")) == 0) {
+    if (knob.state == STATE_PROGRAM) enter_state(STATE_IDLE);
+    program_clear();
+    Serial.println(F("ok"));
+    return;
+  }
+  if (*args) {
+    if (knob.state == STATE_PROGRAM) enter_state(STATE_IDLE);
+    switch (program_store(args)) {
+      case PROGRAM_BAD_SYNTAX: Serial.println(F("usage: prog <minutes><s|b|l> ... (...)x<n>")); return;
+      case PROGRAM_TOO_LONG: Serial.println(F("error: more than 32 phases")); return;
+      case PROGRAM_BAD_PHASE: Serial.println(F("error: phases are 1..120 minutes")); return;
+    }
+  }
+  if (program_valid()) program_print(Serial);
+  else Serial.println(F("no program"));
+}
+
+// "i2c" prints the bus counters. With -DI2C_FAULTS, "i2c <oled|rtc> <count>"
+// first makes the device's next count transfers hang like a stuck slave
+static void cmd_i2c(char *args) {
+#ifdef I2C_FAULTS
+  char *name = next_word(&args);
+  if (*name) {
+    uint8_t dev = strcmp_P(name, PSTR("oled")) == 0 ? I2C_OLED : strcmp_P(name, PSTR("rtc")) == 0 ? I2C_RTC : I2C_DEVICES;
+    long count;
+    if (dev == I2C_DEVICES || !next_number(&args, &count)) {
+      Serial.println(F("error: i2c <oled|rtc> <count>"));
+      return;
+    }
+    i2c_inject(dev, count > 255 ? 255 : count);
+  }
+#endif
+  i2c_report(Serial);
+}
+
+static void cmd_stats(char *args) {
+  perf_report(Serial);
+  ram_report(Serial);
+  mirror_report(Serial);
+  stats_report(Serial);
+  i2c_report(Serial);
+  brightness_report(Serial);
+
+  unsigned long now = clock_millis();
+  for (uint8_t i = 0; i < timers_count(); i++) {
+    const KnobTimer *t = timers_get(i);
+    Serial.print(F("timer "));
+    Serial.print(t->name);
+    Serial.print(F(" ms left: "));
+    Serial.println(t->deadline - now);
+  }
+
+  Serial.print(F("shell commands: "));
+  Serial.println(commandsRun);
+  Serial.print(F("shell parse us last/max: "));
+  Serial.print(parseUsLast);
+  Serial.print('/');
+  Serial.println(parseUsMax);
+}
+
+// side timers by the name "stats" lists them with
+static void cmd_cancel(char *args) {
+  char *name = next_word(&args);
+  for (uint8_t i = 0; i < timers_count(); i++) {
+    const KnobTimer *t = timers_get(i);
+    if (strcmp(t->name, name) == 0) {
+      timers_cancel(t->id);
+      Serial.println(F("ok"));
+      return;
+    }
+  }
+  Serial.println(F("error: no such timer"));
+}
+
+static const ShellCommand commands[] PROGMEM = {
+  {"help", cmd_help},
+  {"get", cmd_get},
+  {"set", cmd_set},
+  {"start", cmd_start},
+  {"stop", cmd_stop},
+  {"pause", cmd_pause},
+  {"time", cmd_time},
+  {"stats", cmd_stats},
+  {"cancel", cmd_cancel},
+  {"sched", cmd_sched},
+  {"mirror", cmd_mirror},
+  {"i2c", cmd_i2c},
+  {"prog", cmd_prog},
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static void cmd_help(char *args) {
+  for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+    Serial.println((const __FlashStringHelper *)commands[i].name);
+  }
+}
+
+static void run_line() {
+  unsigned long start = micros();
+
+  char *args = line;
+  char *name = next_word(&args);
+  ShellCommand command;
+  bool found = false;
+  for (uint8_t i = 0; i < COMMAND_COUNT && !found; i++) {
+    memcpy_P(&command, &commands[i], sizeof(command));
+    found = strcmp(name, command.name) == 0;
+  }
+
+  // both loops above are bounded by SHELL_LINE_LEN and the table size
+  parseUsLast = micros() - start;
+  if (parseUsLast > parseUsMax) parseUsMax = parseUsLast;
+
+  if (!found) {
+    Serial.println(F("error: unknown command, try help"));
+    return;
+  }
+  commandsRun++;
+  command.run(args);
+}
+
+void shell_poll() {
+  // at most what the 64 byte receive buffer holds, no waiting
+  int n = Serial.available();
+  while (n-- > 0) {
+    char c = Serial.read();
+
+    if (c == '\r' || c == '\n') {
+      if (overflow) Serial.println(F("error: line too long"));
+      else if (lineLength) {
+        line[lineLength] = 0;
+        run_line();
+      }
+      lineLength = 0;
+      overflow = false;
+      if (knob.state == STATE_MIRROR) return; // what follows is binary, for mirror_poll()
+    }
+    else if (lineLength < SHELL_LINE_LEN) line[lineLength++] = c;
+    else overflow = true;
+  }
+}
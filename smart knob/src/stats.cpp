@@ -0,0 +1,116 @@
+#include "stats.h"
+#include <EEPROM.h>
+#include "clock.h"
+
+static_assert(sizeof(FocusStats) == STATS_SIZE, "eeprom_map.h reserves STATS_SIZE for the stats");
+
+#define EE_DATA (EE_STATS + 1)
+
+static FocusStats stats;
+static bool dirty = false;
+static bool loaded = false; // until stats_begin(), stats is zeros and must not reach EEPROM
+
+static uint16_t day_of(uint32_t now) {
+  return now / 86400UL;
+}
+
+void stats_save() {
+  if (!dirty || !loaded) return;
+  EEPROM.put(EE_DATA, stats); // update(), only the bytes that changed
+  dirty = false;
+}
+
+void stats_clear() {
+  memset(&stats, 0, sizeof(stats));
+  stats.day = day_of(clock_now().unixtime());
+  dirty = true;
+  stats_save();
+}
+
+static bool roll(uint32_t now);
+
+void stats_begin() {
+  loaded = true;
+  if (EEPROM.read(EE_STATS) != EE_STATS_MAGIC) {
+    EEPROM.update(EE_STATS, EE_STATS_MAGIC);
+    stats_clear();
+    return;
+  }
+  EEPROM.get(EE_DATA, stats);
+  if (stats.head >= STATS_DAYS) stats_clear();
+  else roll(clock_now().unixtime()); // the knob may have been off for days, saved after the first frame
+}
+
+// day rollover in RAM only, true if it changed anything
+static bool roll(uint32_t now) {
+  uint16_t day = day_of(now);
+  if (day == stats.day) return false;
+
+  // forward: one bucket per day passed, never more than the ring holds.
+  // Backwards (the clock was set) today's bucket just takes the new day
+  if (day > stats.day) {
+    uint16_t passed = day - stats.day;
+    for (uint8_t i = 0; i < passed && i < STATS_DAYS; i++) {
+      stats.head = (stats.head + 1) % STATS_DAYS;
+      stats.week -= stats.minutes[stats.head];
+      stats.minutes[stats.head] = 0;
+    }
+  }
+  stats.day = day;
+  if (day > stats.lastFocus + 1) stats.streak = 0; // a whole day without focus
+
+  dirty = true;
+  return true;
+}
+
+void stats_day(uint32_t now) {
+  if (loaded && roll(now)) stats_save();
+}
+
+void stats_focus(uint32_t now, uint8_t minutes) {
+  if (!loaded) return;
+  stats_day(now);
+
+  if (stats.lastFocus != stats.day) { // first minutes of the day
+    stats.streak = stats.lastFocus + 1 == stats.day && stats.streak < 255 ? stats.streak + 1 : 1;
+    stats.lastFocus = stats.day;
+  }
+  stats.minutes[stats.head] += minutes;
+  stats.week += minutes;
+  dirty = true;
+}
+
+uint16_t stats_today() {
+  return stats.minutes[stats.head];
+}
+
+uint16_t stats_week() {
+  return stats.week;
+}
+
+uint8_t stats_streak() {
+  return stats.streak;
+}
+
+uint8_t stats_bar(uint8_t daysAgo, uint8_t height) {
+  uint16_t minutes = stats.minutes[(stats.head + STATS_DAYS - daysAgo) % STATS_DAYS];
+  if (minutes == 0) return 0;
+  if (minutes >= STATS_BAR_FULL) return height;
+  uint8_t px = (uint32_t)minutes * height / STATS_BAR_FULL;
+  return px ? px : 1;
+}
+
+void stats_report(Print &out) {
+  out.print(F("focus today/week min: "));
+  out.print(stats_today());
+  out.print('/');
+  out.println(stats.week);
+  out.print(F("focus streak days: "));
+  out.println(stats.streak);
+  out.print(F("focus last 7 days:"));
+  for (uint8_t i = STATS_DAYS; i-- > 0;) {
+    out.print(' ');
+    out.print(stats.minutes[(stats.head + STATS_DAYS - i) % STATS_DAYS]);
+  }
+  out.println();
+}
@@ -0,0 +1,97 @@
+#include "timers.h"
+
+static KnobTimer slots[MAX_TIMERS];
+static uint8_t heap[MAX_TIMERS];    // slot indices, heap[0] = soonest deadline
+static uint8_t heapPos[MAX_TIMERS]; // where each slot sits in heap[]
+static uint8_t heapSize = 0;
+static KnobTimer expired;
+
+// millis() wraps, so compare by difference rather than by value
+static bool before(uint8_t a, uint8_t b) {
+  return (long)(slots[a].deadline - slots[b].deadline) < 0;
+}
+
+static void heap_swap(uint8_t i, uint8_t j) {
+  uint8_t t = heap[i];
+  heap[i] = heap[j];
+  heap[j] = t;
+  heapPos[heap[i]] = i;
+  heapPos[heap[j]] = j;
+}
+
+static void sift_up(uint8_t i) {
+  while (i > 0) {
+    uint8_t parent = (i - 1) / 2;
+    if (!before(heap[i], heap[parent])) break;
+    heap_swap(i, parent);
+    i = parent;
+  }
+}
+
+static void sift_down(uint8_t i) {
+  while (true) {
+    uint8_t smallest = i;
+    uint8_t left = 2 * i + 1;
+    uint8_t right = left + 1;
+    if (left < heapSize && before(heap[left], heap[smallest])) smallest = left;
+    if (right < heapSize && before(heap[right], heap[smallest])) smallest = right;
+    if (smallest == i) break;
+    heap_swap(i, smallest);
+    i = smallest;
+  }
+}
+
+static void heap_remove(uint8_t i) {
+  uint8_t slot = heap[i];
+  heapSize--;
+  if (i != heapSize) {
+    heap_swap(i, heapSize);
+    sift_down(i);
+    sift_up(i);
+  }
+  slots[slot].id = 0;
+}
+
+uint8_t timers_add(const char *name, unsigned long deadline) {
+  if (heapSize == MAX_TIMERS) return 0;
+
+  uint8_t slot = 0;
+  while (slots[slot].id != 0) slot++;
+
+  slots[slot].id = slot + 1;
+  slots[slot].deadline = deadline;
+  strncpy(slots[slot].name, name, TIMER_NAME_LEN);
+  slots[slot].name[TIMER_NAME_LEN] = '\0';
+
+  heap[heapSize] = slot;
+  heapPos[slot] = heapSize;
+  heapSize++;
+  sift_up(heapSize - 1);
+  return slots[slot].id;
+}
+
+bool timers_cancel(uint8_t id) {
+  if (id == 0 || id > MAX_TIMERS || slots[id - 1].id == 0) return false;
+  heap_remove(heapPos[id - 1]);
+  return true;
+}
+
+const KnobTimer *timers_next() {
+  return heapSize ? &slots[heap[0]] : NULL;
+}
+
+const KnobTimer *timers_poll(unsigned long now) {
+  if (heapSize == 0 || (long)(now - slots[heap[0]].deadline) < 0) return NULL;
+
+  expired = slots[heap[0]]; // copy out, the slot is free again after this
+  heap_remove(0);
+  return &expired;
+}
+
+uint8_t timers_count() {
+  return heapSize;
+}
+
+const KnobTimer *timers_get(uint8_t i) {
+  return i < heapSize ? &slots[heap[i]] : NULL;
+}
@@ -0,0 +1,191 @@
+#include "trace.h"
+#include "knob.h"
+#include "clock.h"
+#include "perf.h"
+#include "timers.h"
+
+#ifdef TRACE_RECORD
+
+#define TRACE_BUFFER 32
+
+static volatile uint8_t buffer[TRACE_BUFFER];
+static volatile uint8_t head = 0;
+static volatile uint8_t tail = 0;
+static volatile uint16_t dropped = 0;
+static unsigned long lastQuanta = 0;
+
+static uint8_t trace_free() {
+  return (uint8_t)(TRACE_BUFFER - 1 - ((head - tail + TRACE_BUFFER) % TRACE_BUFFER));
+}
+
+static void trace_push(uint8_t b) {
+  buffer[head] = b;
+  head = (head + 1) % TRACE_BUFFER;
+}
+
+static void trace_push_event(uint8_t event, uint16_t quanta) {
+  if (quanta < TRACE_EXTENDED) {
+    if (trace_free() < 1) { dropped++; return; }
+    trace_push((event << 6) | quanta);
+  } else {
+    if (trace_free() < 3) { dropped++; return; }
+    trace_push((event << 6) | TRACE_EXTENDED);
+    trace_push(quanta & 0xFF);
+    trace_push(quanta >> 8);
+  }
+}
+
+// called from the encoder ISR as well as loop(), so keep it short
+void trace_record(uint8_t event) {
+  uint8_t sreg = SREG;
+  cli();
+  unsigned long nowQuanta = clock_millis() / TRACE_QUANTUM_MS;
+  unsigned long delta = nowQuanta - lastQuanta;
+  lastQuanta = nowQuanta;
+  while (delta > 0xFFFF) {
+    trace_push_event(TRACE_WAIT, 0xFFFF);
+    delta -= 0xFFFF;
+  }
+  trace_push_event(event, delta);
+  SREG = sreg;
+}
+
+static void print_byte(uint8_t b) {
+  Serial.print(F("0x"));
+  if (b < 0x10) Serial.print('0');
+  Serial.print(b, HEX);
+  Serial.print(F(", "));
+}
+
+void trace_begin() {
+  uint32_t start = clock_now().unixtime();
+  lastQuanta = clock_millis() / TRACE_QUANTUM_MS;
+  Serial.print(F("TRACE "));
+  for (uint8_t i = 0; i < 4; i++) print_byte(start >> (8 * i));
+  Serial.println();
+}
+
+bool trace_poll() {
+  if (head == tail) return true;
+
+  // lines come out in the same format trace_data.cpp wants them in
+  Serial.print(F("TRACE "));
+  while (tail != head) {
+    print_byte(buffer[tail]);
+    tail = (tail + 1) % TRACE_BUFFER;
+  }
+  Serial.println();
+  if (dropped) {
+    Serial.print(F("TRACE dropped: "));
+    Serial.println(dropped);
+  }
+  return true;
+}
+
+#elif defined(TRACE_REPLAY)
+
+static uint16_t pos = 4;
+static unsigned long nextAt = 0;
+static uint8_t nextEvent = TRACE_WAIT;
+static bool pending = false;
+static bool finished = false;
+static bool firstPoll = true;
+static bool buttonLevel = HIGH;
+static unsigned long realStart = 0;
+
+static bool trace_load_next() {
+  if (pos >= trace_length) return false;
+
+  uint8_t b = pgm_read_byte(&trace_data[pos++]);
+  uint16_t quanta = b & TRACE_EXTENDED;
+  if (quanta == TRACE_EXTENDED) {
+    quanta = pgm_read_byte(&trace_data[pos]) | (pgm_read_byte(&trace_data[pos + 1]) << 8);
+    pos += 2;
+  }
+  nextAt += (unsigned long)quanta * TRACE_QUANTUM_MS;
+  nextEvent = b >> 6;
+  return true;
+}
+
+static void trace_report() {
+  unsigned long realMs = (micros() - realStart) / 1000;
+  unsigned long virtualMs = clock_millis();
+
+  Serial.println(F("REPLAY done"));
+  Serial.print(F("virtual ms: "));
+  Serial.println(virtualMs);
+  Serial.print(F("real ms: "));
+  Serial.println(realMs);
+  if (realMs > 0) {
+    Serial.print(F("speedup: x"));
+    Serial.println(virtualMs / realMs);
+  }
+  perf_report(Serial);
+  Serial.print(F("side timers: "));
+  Serial.println(timers_count());
+  for (uint8_t i = 0; i < timers_count(); i++) {
+    const KnobTimer *t = timers_get(i);
+    Serial.print(F("timer "));
+    Serial.print(t->name);
+    Serial.print(F(" ms left: "));
+    Serial.println(t->deadline - clock_millis());
+  }
+  KnobState k = knob_snapshot();
+  Serial.print(F("final state: "));
+  Serial.println(k.state);
+  Serial.print(F("study/break/cycle/timer: "));
+  Serial.print(k.study_time);
+  Serial.print('/');
+  Serial.print(k.break_time);
+  Serial.print('/');
+  Serial.print(k.cycle);
+  Serial.print('/');
+  Serial.println(k.timer_time);
+}
+
+void trace_begin() {
+  uint32_t start = 0;
+  for (uint8_t i = 0; i < 4; i++) {
+    start |= (uint32_t)pgm_read_byte(&trace_data[i]) << (8 * i);
+  }
+  clock_begin(start);
+  perf_reset();
+  pending = trace_load_next();
+  realStart = micros();
+}
+
+bool trace_button() {
+  return buttonLevel;
+}
+
+bool trace_poll() {
+  if (finished) return false;
+
+  if (firstPoll) firstPoll = false;
+  else clock_advance(TRACE_STEP_MS);
+
+  while (pending && clock_millis() >= nextAt) {
+    if (nextEvent == TRACE_CW) encoder_step(true);
+    else if (nextEvent == TRACE_CCW) encoder_step(false);
+    else if (nextEvent == TRACE_BUTTON) buttonLevel = !buttonLevel;
+    pending = trace_load_next();
+  }
+
+  if (!pending) {
+    finished = true;
+    trace_report();
+    return false;
+  }
+  return true;
+}
+
+#else
+
+void trace_begin() {
+}
+
+bool trace_poll() {
+  return true;
+}
+
+#endif
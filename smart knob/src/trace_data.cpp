@@ -0,0 +1,43 @@
+#include "trace.h"
+
+#ifdef TRACE_REPLAY
+
+#ifdef TRACE_SIDE_TIMER
+
+// -DTRACE_SIDE_TIMER: hold and turn left into the timer setting, which must
+// not count as a press, two detents up to 20 minutes, then a short press
+// starts it as a side timer. Exactly one, T1, should be left running.
+const uint8_t trace_data[] PROGMEM = {
+  0x90, 0x7D, 0x5B, 0x69,   // 2026-01-05 09:00:00
+  0xFF, 0x64, 0x00,         // +1 s    button down
+  0x9E,                     // +300 ms ccw -> STATE_CONFIG_TIMER
+  0xDE,                     // +300 ms button up, ends the hold
+  0x7F, 0x64, 0x00,         // +1 s    cw
+  0x54,                     // +200 ms cw -> 20 minutes
+  0xFF, 0x64, 0x00,         // +1 s    button down
+  0xD4,                     // +200 ms button up -> side timer T1, STATE_IDLE
+  0x3F, 0xF4, 0x01,         // +5 s    wait
+};
+
+#else
+
+// Full 4 session pomodoro: long press in idle, three detents up on the session
+// count, long press to start, then let the plan run out. Paste a recording from
+// a -DTRACE_RECORD build in here to replay that session instead.
+const uint8_t trace_data[] PROGMEM = {
+  0x90, 0x7D, 0x5B, 0x69,   // 2026-01-05 09:00:00
+  0xFF, 0x64, 0x00,         // +1 s    button down
+  0xFF, 0x2C, 0x01,         // +3 s    button up -> STATE_CONFIG_CYCLE
+  0x7F, 0x96, 0x00,         // +1.5 s  cw
+  0x54,                     // +200 ms cw
+  0x54,                     // +200 ms cw -> 4 sessions
+  0xFF, 0x64, 0x00,         // +1 s    button down
+  0xFF, 0x2C, 0x01,         // +3 s    button up -> STATE_STUDY
+  0x3F, 0x20, 0x4E,         // +200 s  wait for the plan to finish
+};
+
+#endif
+
+const uint16_t trace_length = sizeof(trace_data);
+
+#endif
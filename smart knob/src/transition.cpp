@@ -0,0 +1,47 @@
+#include "transition.h"
+#include "display.h"
+#include "knob.h"
+#include "clock.h"
+#include "perf.h"
+#include "trace.h"
+#include "i2c.h"
+
+static_assert(64 % TRANSITION_ROWS == 0 && 8 % TRANSITION_ROWS == 0, "steps have to land on every page boundary");
+
+static void start_line(uint8_t line) {
+  perf_oled_command();
+  if (TRACE_SKIP_OUTPUT || !i2c_start(I2C_OLED)) return;
+  oled.ssd1306_command(SSD1306_SETSTARTLINE | (line & 63));
+  i2c_done(I2C_OLED);
+}
+
+static void push_page(uint8_t page) {
+  oled_show_rect(0, page * 8, oled.width() - 1, page * 8 + 7);
+}
+
+// Panel row r shows RAM row (r + start) % 64, so all 64 RAM rows are on the
+// panel all the time and no page can be written out of sight. Going up, page
+// p is the top 8 rows (the leaving edge) when the start line is at 8p; it is
+// pushed there and the steps wrap it to the bottom TRANSITION_ROWS at a time.
+// Until they have, the top shows what is left of the new page, up to
+// 8 - TRANSITION_ROWS = 6 rows on top of the old screen's last ones: a torn
+// band at the leaving edge, one per page. Going down it is the bottom edge.
+// Pushing a step later would only move the band to the entering edge, as
+// old rows coming in, where the eye is.
+void oled_transition(TransitionDir dir) {
+  unsigned long bytes = perf.i2c_bytes;
+
+  for (uint8_t x = 0; x < 64; x += TRANSITION_ROWS) {
+    if (dir == SLIDE_UP) {
+      if (x % 8 == 0) push_page(x / 8);
+      start_line(x + TRANSITION_ROWS);
+    } else {
+      if (x % 8 == 0) push_page(7 - x / 8);
+      start_line(64 - x - TRANSITION_ROWS);
+    }
+    clock_delay(TRANSITION_STEP_MS);
+  }
+
+  perf.oled_transitions++;
+  perf.oled_transition_bytes += perf.i2c_bytes - bytes;
+}
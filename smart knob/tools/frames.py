@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+# Turns a FRAME_CAPTURE serial log (see include/capture.h) into pictures and
+# checks it against golden frames.
+#
+#   pio run -e capture -t upload && pio device monitor -b 1000000 > capture.log
+#   tools/frames.py capture.log --out frames          PPM files
+#   tools/frames.py capture.log --show                terminal art
+#   tools/frames.py capture.log --golden golden --update
+#   tools/frames.py capture.log --golden golden       exit 1 on any difference
+#
+# Every run prints the per-frame cost (draw calls, pixels drawn, I2C bytes,
+# LED current). Against a golden set it also flags frames whose cost went up,
+# so a rendering change that still looks right but got slower shows up too.
+
+import argparse
+import os
+import sys
+
+OLED_W, OLED_H = 128, 64
+LED_SCALE = 8  # each ring pixel becomes an 8x8 block in the strip image
+
+
+class Frame:
+    def __init__(self, kind, seq, stats, data):
+        self.kind = kind
+        self.seq = seq
+        self.stats = stats
+        self.data = data
+
+    @property
+    def name(self):
+        return "%s_%04d" % (self.kind, self.seq)
+
+
+def parse(lines):
+    frames = []
+    header = None
+    for line in lines:
+        line = line.strip()
+        if header:
+            try:
+                data = bytes.fromhex(line)
+            except ValueError:
+                data = None  # line got cut or mixed with other output
+            if data is not None:
+                kind, seq, stats = header
+                frames.append(Frame(kind, seq, stats, data))
+            header = None
+        elif line.startswith("FRAME "):
+            parts = line.split()
+            header = (parts[1], int(parts[2]), [int(v) for v in parts[3:]])
+    return frames
+
+
+def oled_pixel(data, x, y):
+    return (data[x + (y // 8) * OLED_W] >> (y & 7)) & 1
+
+
+def ppm(frame):
+    if frame.kind == "oled":
+        rgb = bytearray()
+        for y in range(OLED_H):
+            for x in range(OLED_W):
+                rgb += b"\xff\xff\xff" if oled_pixel(frame.data, x, y) else b"\x00\x00\x00"
+        w, h = OLED_W, OLED_H
+    else:
+        count = len(frame.data) // 3
+        row = bytearray()
+        for i in range(count):
+            g, r, b = frame.data[i * 3:i * 3 + 3]  # wire order is GRB
+            row += bytes((r, g, b)) * LED_SCALE
+        rgb = row * LED_SCALE
+        w, h = count * LED_SCALE, LED_SCALE
+    return b"P6\n%d %d\n255\n" % (w, h) + bytes(rgb)
+
+
+def terminal_art(frame):
+    if frame.kind == "oled":
+        # two pixel rows per character cell
+        blocks = {(0, 0): " ", (1, 0): "▀", (0, 1): "▄", (1, 1): "█"}
+        rows = []
+        for y in range(0, OLED_H, 2):
+            rows.append("".join(blocks[oled_pixel(frame.data, x, y), oled_pixel(frame.data, x, y + 1)]
+                                for x in range(OLED_W)))
+        return "\n".join(rows)
+    cells = []
+    for i in range(len(frame.data) // 3):
+        g, r, b = frame.data[i * 3:i * 3 + 3]
+        cells.append("\x1b[48;2;%d;%d;%dm  \x1b[0m" % (r, g, b))
+    return "".join(cells)
+
+
+def describe(frame):
+    if frame.kind == "oled":
+        calls, pixels, i2c = frame.stats
+        return "%s  calls %5d  pixels %6d  i2c %5d" % (frame.name, calls, pixels, i2c)
+    lit, ma = frame.stats
+    return "%s  lit %2d  mA %4d" % (frame.name, lit, ma)
+
+
+def cost(frame):
+    # what counts as "more expensive" for each kind
+    if frame.kind == "oled":
+        return frame.stats
+    return frame.stats[1:]
+
+
+def load_golden(folder):
+    golden = {}
+    path = os.path.join(folder, "frames.log")
+    if os.path.exists(path):
+        with open(path) as f:
+            for frame in parse(f):
+                golden[frame.name] = frame
+    return golden
+
+
+def save_golden(folder, frames):
+    os.makedirs(folder, exist_ok=True)
+    with open(os.path.join(folder, "frames.log"), "w") as f:
+        for frame in frames:
+            f.write("FRAME %s %d %s\n%s\n" % (frame.kind, frame.seq, " ".join(map(str, frame.stats)), frame.data.hex()))
+
+
+def diff_pixels(a, b):
+    return sum(bin(x ^ y).count("1") for x, y in zip(a, b)) + 8 * abs(len(a) - len(b))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="FRAME_CAPTURE log to PPM / terminal art, golden frame check")
+    ap.add_argument("log", help="serial log of a FRAME_CAPTURE run, - for stdin")
+    ap.add_argument("--out", help="write one PPM per frame into this folder")
+    ap.add_argument("--show", action="store_true", help="print the frames as terminal art")
+    ap.add_argument("--golden", help="folder with the golden frames")
+    ap.add_argument("--update", action="store_true", help="replace the golden frames with this log")
+    args = ap.parse_args()
+
+    lines = list(sys.stdin if args.log == "-" else open(args.log, errors="replace"))
+    frames = parse(lines)
+    if not frames:
+        sys.exit("no FRAME lines in %s" % args.log)
+
+    if args.out:
+        os.makedirs(args.out, exist_ok=True)
+        for frame in frames:
+            with open(os.path.join(args.out, frame.name + ".ppm"), "wb") as f:
+                f.write(ppm(frame))
+
+    for frame in frames:
+        print(describe(frame))
+        if args.show:
+            print(terminal_art(frame))
+
+    oled = [f for f in frames if f.kind == "oled"]
+    print("oled frames %d  calls %d  pixels %d  i2c %d" % (
+        len(oled), sum(f.stats[0] for f in oled), sum(f.stats[1] for f in oled), sum(f.stats[2] for f in oled)))
+    print("led frames %d" % (len(frames) - len(oled)))
+
+    if not args.golden:
+        return
+    if args.update:
+        save_golden(args.golden, frames)
+        print("golden frames updated")
+        return
+
+    golden = load_golden(args.golden)
+    if not golden:
+        sys.exit("no golden frames in %s, run with --update first" % args.golden)
+
+    failed = 0
+    for frame in frames:
+        want = golden.pop(frame.name, None)
+        if want is None:
+            print("%s: new frame" % frame.name)
+            failed += 1
+        elif want.data != frame.data:
+            print("%s: %d pixels differ" % (frame.name, diff_pixels(want.data, frame.data)))
+            failed += 1
+        elif any(now > before for now, before in zip(cost(frame), cost(want))):
+            print("%s: costs more, %s -> %s" % (frame.name, describe(want), describe(frame)))
+            failed += 1
+    for name in sorted(golden):
+        print("%s: missing" % name)
+        failed += 1
+
+    print("%d frames differ from %s" % (failed, args.golden) if failed else "all frames match %s" % args.golden)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,453 @@
+#!/usr/bin/env python3
+# Drives the knob's mirror mode (see include/mirror.h) from a PC: pushes oled
+# page deltas and LED ring runs over the serial link and reports what got
+# through.
+#
+#   tools/mirror.py /dev/ttyUSB0 --pbm status.pbm --leds 8:00ff00,24:000000
+#   tools/mirror.py /dev/ttyUSB0 --countdown 5       meeting countdown
+#   tools/mirror.py /dev/ttyUSB0 --bench 200         fps and byte efficiency
+#   tools/mirror.py --emulate --bench 200 --corrupt 0.01
+#   tools/mirror.py --dump frames.bin --bench 3      wire bytes, no device
+#
+# --emulate runs a model of the firmware's decoder on a local pty instead of
+# a real port (no pyserial needed) and checks at the end that its oled
+# buffer and ring match what was sent. --corrupt flips random bytes on the
+# way there to exercise the NAK/resend path.
+#
+# A real port needs pyserial. The script opens it at the shell speed, sends
+# "mirror <baud>", then switches to <baud> for the binary protocol.
+
+import argparse
+import os
+import random
+import select
+import sys
+import threading
+import time
+import tty
+
+OLED_W, OLED_H = 128, 64
+PAGES = OLED_H // 8
+RING_PIXELS = 24
+RING_MAX_RUNS = 8
+ACK, NAK = 0x06, 0x15
+# a 'P' frame costs this much on top of its data: type, page, col, len, crc,
+# COBS code byte, delimiter
+P_OVERHEAD = 8
+
+
+def crc16(data):
+    """CRC-16/MCRF4XX, what avr-libc's _crc_ccitt_update() computes from 0xFFFF."""
+    crc = 0xFFFF
+    for b in data:
+        b ^= crc & 0xFF
+        b = (b ^ (b << 4)) & 0xFF
+        crc = ((b << 8) | (crc >> 8)) ^ (b >> 4) ^ (b << 3)
+        crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray()
+    block = bytearray()
+    for b in data:
+        if b == 0:
+            out.append(len(block) + 1)
+            out += block
+            block = bytearray()
+            continue
+        block.append(b)
+        if len(block) == 254:
+            out.append(255)
+            out += block
+            block = bytearray()
+    out.append(len(block) + 1)
+    out += block
+    out.append(0)
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            raise ValueError("bad COBS block")
+        out += data[i + 1:i + code]
+        i += code
+        if code != 255 and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frame(body):
+    c = crc16(body)
+    return cobs_encode(body + bytes([c & 0xFF, c >> 8]))
+
+
+def page_frame(page, col, data):
+    return frame(bytes([ord('P'), page, col, len(data)]) + bytes(data))
+
+
+def led_frame(runs):
+    body = bytearray([ord('L'), len(runs)])
+    for end, (r, g, b) in runs:
+        body += bytes([end & 0xFF, end >> 8, r, g, b])
+    return frame(bytes(body))
+
+
+END_FRAME = frame(b'F')
+EXIT = frame(b'X')
+
+
+def page_deltas(old, new):
+    """(page, col, bytes) spans that differ. Gaps shorter than a frame's own
+    overhead are sent along instead of starting a new frame."""
+    out = []
+    for page in range(PAGES):
+        base = page * OLED_W
+        cols = [x for x in range(OLED_W) if old[base + x] != new[base + x]]
+        if not cols:
+            continue
+        start = prev = cols[0]
+        for x in cols[1:] + [None]:
+            if x is not None and x - prev <= P_OVERHEAD:
+                prev = x
+                continue
+            out.append((page, start, new[base + start:base + prev + 1]))
+            if x is not None:
+                start = prev = x
+    return out
+
+
+class Canvas:
+    """1 bit per pixel in the SSD1306 buffer layout: one byte is 8 rows of a column."""
+
+    def __init__(self):
+        self.buf = bytearray(OLED_W * PAGES)
+
+    def pixel(self, x, y, on=True):
+        if 0 <= x < OLED_W and 0 <= y < OLED_H:
+            bit = 1 << (y & 7)
+            i = (y >> 3) * OLED_W + x
+            self.buf[i] = self.buf[i] | bit if on else self.buf[i] & ~bit
+
+    def rect(self, x0, y0, x1, y1, on=True):
+        for y in range(y0, y1 + 1):
+            for x in range(x0, x1 + 1):
+                self.pixel(x, y, on)
+
+
+def read_pbm(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    magic, w, h = fields[0], int(fields[1]), int(fields[2])
+    if (w, h) != (OLED_W, OLED_H):
+        sys.exit(f"{path}: need {OLED_W}x{OLED_H}, got {w}x{h}")
+
+    c = Canvas()
+    if magic == b'P4':
+        raw = data[pos + 1:]
+        row = (w + 7) // 8
+        for y in range(h):
+            for x in range(w):
+                if raw[y * row + x // 8] & (0x80 >> (x & 7)):
+                    c.pixel(x, y)
+    elif magic == b'P1':
+        bits = [ch for ch in data[pos:].decode() if ch in '01']
+        for i, ch in enumerate(bits[:w * h]):
+            if ch == '1':
+                c.pixel(i % w, i // w)
+    else:
+        sys.exit(f"{path}: only P1/P4 pbm")
+    return c.buf
+
+
+def lit_runs(first, end, colour):
+    """Ring runs for pixels first..end-1 lit, the rest dark."""
+    dark = (0, 0, 0)
+    runs = [(first, dark)] if first else []
+    if end > first:
+        runs.append((end, colour))
+    if end < RING_PIXELS:
+        runs.append((RING_PIXELS, dark))
+    return runs
+
+
+def parse_leds(spec):
+    """'8:ff0000,24:000000' -> [(8, (255, 0, 0)), (24, (0, 0, 0))]"""
+    runs = []
+    for part in spec.split(','):
+        end, colour = part.split(':')
+        v = int(colour, 16)
+        runs.append((int(end), (v >> 16, (v >> 8) & 0xFF, v & 0xFF)))
+    return runs
+
+
+# --- links ---------------------------------------------------------------
+
+class FdLink:
+    def __init__(self, fd):
+        self.fd = fd
+
+    def write(self, data):
+        os.write(self.fd, data)
+
+    def read_byte(self, timeout):
+        r, _, _ = select.select([self.fd], [], [], timeout)
+        return os.read(self.fd, 1)[0] if r else None
+
+    def drain(self):
+        while self.read_byte(0) is not None:
+            pass
+
+
+class SerialLink:
+    def __init__(self, port, shell_baud, baud):
+        import serial
+        self.s = serial.Serial(port, shell_baud, timeout=2)
+        time.sleep(2)  # the Nano resets when the port opens
+        self.s.reset_input_buffer()
+        self.s.write(f"mirror {baud}\n".encode())
+        while True:
+            line = self.s.readline()
+            if not line:
+                sys.exit("no answer to 'mirror', is the shell running?")
+            if line.strip() == b'ok':
+                break
+        self.s.flush()
+        time.sleep(0.05)
+        self.s.baudrate = baud
+
+    def write(self, data):
+        self.s.write(data)
+
+    def read_byte(self, timeout):
+        self.s.timeout = timeout
+        b = self.s.read(1)
+        return b[0] if b else None
+
+    def drain(self):
+        self.s.reset_input_buffer()
+
+
+class DumpLink:
+    def __init__(self, path):
+        self.f = open(path, 'wb')
+
+    def write(self, data):
+        self.f.write(data)
+
+    def read_byte(self, timeout):
+        return ACK
+
+    def drain(self):
+        pass
+
+
+class Emulator(threading.Thread):
+    """What the firmware does with the stream, minus the hardware."""
+
+    def __init__(self, fd, corrupt):
+        super().__init__(daemon=True)
+        self.fd = fd
+        self.corrupt = corrupt
+        self.oled = bytearray(OLED_W * PAGES)
+        self.runs = [(RING_PIXELS, (0, 0, 0))]
+        self.bad = 0
+        self.done = False
+
+    def apply(self, body):
+        t = chr(body[0])
+        if t == 'P' and len(body) >= 4:
+            page, col, n = body[1], body[2], body[3]
+            if page >= PAGES or n == 0 or col + n > OLED_W or len(body) != 4 + n:
+                return False
+            base = page * OLED_W + col
+            self.oled[base:base + n] = body[4:]
+        elif t == 'L' and len(body) >= 2:
+            n = body[1]
+            if not 0 < n <= RING_MAX_RUNS or len(body) != 2 + 5 * n:
+                return False
+            runs = []
+            for k in range(n):
+                r = body[2 + 5 * k:7 + 5 * k]
+                runs.append((r[0] | r[1] << 8, (r[2], r[3], r[4])))
+            ends = [e for e, _ in runs]
+            if ends != sorted(set(ends)) or ends[-1] != RING_PIXELS:
+                return False
+            self.runs = runs
+        elif t == 'X' and len(body) == 1:
+            self.done = True
+        elif not (t == 'F' and len(body) == 1):
+            return False
+        return True
+
+    def run(self):
+        rnd = random.Random(1)
+        pending = bytearray()
+        while not self.done:
+            for b in os.read(self.fd, 4096):
+                if self.corrupt and rnd.random() < self.corrupt:
+                    b = rnd.randrange(256)
+                if b:
+                    pending.append(b)
+                    continue
+                if not pending:
+                    continue  # a lone 0
+                try:
+                    data = cobs_decode(bytes(pending))
+                    ok = len(data) > 2 and crc16(data) == 0 and self.apply(data[:-2])
+                except ValueError:
+                    ok = False
+                pending = bytearray()
+                if not ok:
+                    self.bad += 1
+                os.write(self.fd, bytes([ACK if ok else NAK]))
+
+
+# --- sender --------------------------------------------------------------
+
+class Mirror:
+    def __init__(self, link):
+        self.link = link
+        self.shown = bytearray(OLED_W * PAGES)  # the device clears on entry
+        self.frames = 0
+        self.wire = 0
+        self.payload = 0
+        self.resends = 0
+
+    def send(self, data, payload=0):
+        for attempt in range(8):
+            # a frame cut in two by a corrupted 0 gets two NAKs, drop the spare
+            self.link.drain()
+            self.link.write(data)
+            self.wire += len(data)
+            reply = self.link.read_byte(0.5)
+            while reply is not None and reply not in (ACK, NAK):
+                reply = self.link.read_byte(0.5)  # stray text, e.g. a side timer
+            if reply == ACK:
+                self.payload += payload
+                return
+            self.resends += 1
+            if reply is None:
+                # the delimiter may have been lost: end whatever the device
+                # is holding and let its NAK for that go by
+                self.link.write(b'\0')
+                self.wire += 1
+                self.link.read_byte(0.05)
+        sys.exit("device stopped answering")
+
+    def show(self, oled=None, leds=None):
+        if oled is not None:
+            for page, col, data in page_deltas(self.shown, oled):
+                self.send(page_frame(page, col, data), len(data))
+            self.shown[:] = oled
+        if leds is not None:
+            self.send(led_frame(leds), 5 * len(leds))
+        self.send(END_FRAME)
+        self.frames += 1
+
+    def report(self, seconds):
+        print(f"frames: {self.frames} in {seconds:.2f} s, {self.frames / seconds:.1f} fps")
+        pct = 100.0 * self.payload / self.wire if self.wire else 0.0
+        print(f"payload/wire bytes: {self.payload}/{self.wire} ({pct:.1f}%)")
+        print(f"resends: {self.resends}")
+
+
+def bench_frames(n):
+    """A bar sweeping across the oled and a lit run going round the ring:
+    every frame changes a few columns on every page and two LED runs."""
+    for i in range(n):
+        c = Canvas()
+        x = i * 3 % (OLED_W - 8)
+        c.rect(x, 0, x + 7, OLED_H - 1)
+        p = i % RING_PIXELS
+        yield c.buf, lit_runs(p, p + 1, (0, 0, 80))
+
+
+def countdown_frames(minutes):
+    total = minutes * 60
+    start = time.monotonic()
+    while True:
+        left = max(0, total - int(time.monotonic() - start))
+        c = Canvas()
+        c.rect(0, 0, OLED_W - 1, 3)
+        c.rect(0, 60, OLED_W - 1, 63)
+        width = (OLED_W - 8) * left // total
+        if width:
+            c.rect(4, 16, 3 + width, 47)
+        lit = (RING_PIXELS * left + total - 1) // total
+        yield c.buf, lit_runs(0, lit, (0, 60, 0))
+        if not left:
+            return
+        time.sleep(1 - (time.monotonic() - start) % 1)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument("port", nargs="?")
+    ap.add_argument("--baud", type=int, default=1000000)
+    ap.add_argument("--shell-baud", type=int, default=9600, help="SERIAL_BAUD of the firmware")
+    ap.add_argument("--emulate", action="store_true", help="decoder model on a local pty")
+    ap.add_argument("--corrupt", type=float, default=0.0, help="byte error rate towards the emulator")
+    ap.add_argument("--dump", help="write the wire bytes to a file instead")
+    ap.add_argument("--pbm", help="128x64 P1/P4 image for the oled")
+    ap.add_argument("--leds", help="ring runs, end:rrggbb,...")
+    ap.add_argument("--bench", type=int, metavar="N", help="N animated frames")
+    ap.add_argument("--countdown", type=int, metavar="MIN")
+    ap.add_argument("--stay", action="store_true", help="leave the knob in mirror mode")
+    args = ap.parse_args()
+
+    emulator = None
+    if args.emulate:
+        host, dev = os.openpty()
+        tty.setraw(host)
+        tty.setraw(dev)
+        emulator = Emulator(dev, args.corrupt)
+        emulator.start()
+        link = FdLink(host)
+    elif args.dump:
+        link = DumpLink(args.dump)
+    elif args.port:
+        link = SerialLink(args.port, args.shell_baud, args.baud)
+    else:
+        ap.error("need a port, --emulate or --dump")
+
+    m = Mirror(link)
+    started = time.monotonic()
+    last_leds = None
+    if args.pbm or args.leds:
+        last_leds = parse_leds(args.leds) if args.leds else None
+        m.show(read_pbm(args.pbm) if args.pbm else None, last_leds)
+    frames = bench_frames(args.bench) if args.bench else countdown_frames(args.countdown) if args.countdown else ()
+    for oled, leds in frames:
+        m.show(oled, leds)
+        last_leds = leds
+    if not args.stay:
+        m.send(EXIT)
+    m.report(max(time.monotonic() - started, 1e-6))
+
+    if emulator:
+        emulator.join(1)
+        same = emulator.oled == m.shown and (last_leds is None or emulator.runs == last_leds)
+        print(f"emulator: bad frames {emulator.bad}, buffers {'match' if same else 'DIFFER'}")
+        sys.exit(0 if same else 1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,107 @@
+# PlatformIO post-build step: SRAM budget for the ATmega328.
+#
+# Reads the linker map, sums .data/.bss per module and fails the build when
+# what is left for the stack drops under custom_ram_margin. The SSD1306 frame
+# buffer and the NeoPixel buffer are malloc'd in begin()/the constructor, so
+# they don't show up in the map; custom_ram_heap accounts for the frame
+# buffer, the NeoPixel one follows -DRING_PIXELS and is left out with
+# -DLED_BACKEND_SPI, which needs no pixel buffer.
+
+import os
+import re
+
+Import("env")
+
+RAM_SIZE = 2048
+RING_PIXELS = 24   # include/ring.h default
+MALLOC_HEADER = 2
+
+# symbol name patterns -> module, first match wins. _ZZ are function statics.
+MODULES = [
+    (r"oled|SSD1306", "display"),
+    (r"NeoPixel", "leds"),
+    (r"rtc|RTC|DS1307", "rtc"),
+    (r"twi_|Wire", "wire"),
+    (r"Serial|HardwareSerial|_rx_buffer|_tx_buffer", "serial"),
+    (r"_ZZ\d*\w*_state", "state statics"),
+    (r"^knob", "knob state"),
+    (r"trace|Trace", "trace"),
+    (r"perf", "perf"),
+    (r"timers|slots|heap", "timers"),
+]
+
+SECTION = re.compile(
+    r"^ (\.(?:data|bss)(?:\.(\S+))?)\s*\n?\s+0x[0-9a-f]+\s+0x([0-9a-f]+)\s+(\S+)",
+    re.M)
+
+
+def classify(symbol, obj):
+    member = re.search(r"\((.+?)\)$", obj)
+    name = os.path.basename(member.group(1) if member else obj)
+    # symbol name from -fdata-sections first, then the object file
+    for text in (symbol, name):
+        for pattern, module in MODULES:
+            if text and re.search(pattern, text):
+                return module
+    return name.split(".")[0]
+
+
+def define(env, name):
+    """Value of -Dname from build_flags, True without one, None if unset."""
+    for d in env.get("CPPDEFINES", []):
+        if isinstance(d, (list, tuple)):
+            if d[0] == name:
+                return d[1] if len(d) > 1 else True
+        elif d == name:
+            return True
+    return None
+
+
+def pixel_heap(env):
+    if define(env, "LED_BACKEND_SPI"):
+        return 0
+    pixels = define(env, "RING_PIXELS")
+    pixels = int(pixels) if pixels not in (None, True) else RING_PIXELS
+    return pixels * 3 + MALLOC_HEADER
+
+
+def ram_budget(source, target, env):
+    map_path = os.path.join(env.subst("$BUILD_DIR"), "firmware.map")
+    if not os.path.isfile(map_path):
+        print("ram_budget: no %s, add -Wl,-Map to build_flags" % map_path)
+        return
+
+    with open(map_path) as f:
+        text = f.read()
+    # only the output section listings, not the discarded/memory config parts
+    start = text.find("Linker script and memory map")
+    text = text[start:] if start >= 0 else text
+
+    modules = {}
+    for m in SECTION.finditer(text):
+        size = int(m.group(3), 16)
+        if size == 0:
+            continue
+        module = classify(m.group(2), m.group(4))
+        kind = "data" if m.group(1).startswith(".data") else "bss"
+        entry = modules.setdefault(module, {"data": 0, "bss": 0})
+        entry[kind] += size
+
+    pixels = pixel_heap(env)
+    heap = int(env.GetProjectOption("custom_ram_heap", "0")) + pixels
+    margin = int(env.GetProjectOption("custom_ram_margin", "256"))
+    static = sum(e["data"] + e["bss"] for e in modules.values())
+    free = RAM_SIZE - static - heap
+
+    print("RAM budget (bytes)      data    bss")
+    for name, e in sorted(modules.items(), key=lambda kv: -(kv[1]["data"] + kv[1]["bss"])):
+        print("  %-20s %6d %6d" % (name, e["data"], e["bss"]))
+    print("  static %d + heap %d (%d NeoPixel), %d left for the stack (margin %d)"
+          % (static, heap, pixels, free, margin))
+
+    if free < margin:
+        print("ram_budget: only %d bytes left for the stack, need %d" % (free, margin))
+        env.Exit(1)
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_budget)
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+# Checks the report a TRACE_REPLAY run prints (see include/trace.h) against
+# the golden one committed for that trace, so a change in what the state
+# machine does with a recorded session shows up as a failing check.
+#
+#   pio run -e replay && tools/replay_check.py --sim replay      under simavr
+#   pio device monitor > replay.log; tools/replay_check.py replay.log
+#   tools/replay_check.py --sim replay --update                  new golden
+#
+# The replay runs on the virtual clock, so the counters and the final state
+# are the same on every run and every board. What real time it took (real ms,
+# loop and draw us) is left out of the golden files and never compared.
+
+import argparse
+import fnmatch
+import os
+import shutil
+import subprocess
+import sys
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+GOLDEN = os.path.join(HERE, "golden")
+LAST_LINE = "study/break/cycle/timer"  # trace_report() ends with it
+
+# report fields measured in real time, "*" in the golden files
+TIMING = {"real ms", "speedup", "loop us min/avg/max", "draw us", "led us"}
+
+
+def parse(lines):
+    """The report after "REPLAY done" as (key, value) pairs, in order."""
+    report = []
+    started = False
+    for line in lines:
+        line = line.strip()
+        if line.endswith("REPLAY done"):  # may follow other output on its line
+            started = True
+            report = []
+        elif started and ": " in line:
+            key, value = line.split(": ", 1)
+            report.append((key, value))
+            if key == LAST_LINE:
+                break
+    return report
+
+
+def mask(key, value):
+    # "screens full/partial, draw us: 10/4, 7" pairs up on the ", "
+    keys, values = key.split(", "), value.split(", ")
+    if len(keys) != len(values):
+        return "*" if key in TIMING else value
+    return ", ".join("*" if k in TIMING else v for k, v in zip(keys, values))
+
+
+def simavr():
+    path = os.path.expanduser("~/.platformio/packages/tool-simavr/bin/simavr")
+    return path if os.path.exists(path) else shutil.which("simavr")
+
+
+def run_sim(env):
+    sim = simavr()
+    if not sim:
+        sys.exit("no simavr, the replay envs pull it in with platform_packages")
+    elf = os.path.join(HERE, "..", ".pio", "build", env, "firmware.elf")
+    if not os.path.exists(elf):
+        sys.exit("no %s, pio run -e %s first" % (elf, env))
+
+    # the firmware spins in loop() once the trace ran out, stop at the last line
+    proc = subprocess.Popen([sim, "-m", "atmega328p", "-f", "16000000", elf],
+                            stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True, errors="replace")
+    lines = []
+    try:
+        for line in proc.stdout:
+            lines.append(line)
+            if line.strip().startswith(LAST_LINE):
+                break
+    finally:
+        proc.kill()
+    return lines
+
+
+def main():
+    ap = argparse.ArgumentParser(description="TRACE_REPLAY report against its golden file")
+    ap.add_argument("log", nargs="?", help="serial log of a replay run, - for stdin")
+    ap.add_argument("--sim", metavar="ENV", help="run .pio/build/ENV/firmware.elf under simavr instead")
+    ap.add_argument("--golden", help="golden file, tools/golden/<env>.txt by default")
+    ap.add_argument("--update", action="store_true", help="write this run as the golden file")
+    args = ap.parse_args()
+
+    if args.sim:
+        lines = run_sim(args.sim)
+    elif args.log:
+        lines = list(sys.stdin if args.log == "-" else open(args.log, errors="replace"))
+    else:
+        ap.error("a log or --sim ENV")
+    golden = args.golden or os.path.join(GOLDEN, "%s.txt" % (args.sim or "replay"))
+
+    report = [(k, mask(k, v)) for k, v in parse(lines)]
+    if not report or report[-1][0] != LAST_LINE:
+        sys.exit("no complete replay report in the output")
+
+    if args.update:
+        os.makedirs(os.path.dirname(golden), exist_ok=True)
+        with open(golden, "w") as f:
+            f.write("# tools/replay_check.py --update, \"*\" is real time and not compared\n")
+            for key, value in report:
+                f.write("%s: %s\n" % (key, value))
+        print("%s updated" % golden)
+        return
+
+    if not os.path.exists(golden):
+        sys.exit("no %s, run with --update first" % golden)
+    with open(golden) as f:
+        want = parse(["REPLAY done"] + [l for l in f if not l.startswith("#")])
+
+    got = dict(report)
+    failed = 0
+    for key, value in want:
+        if key not in got:
+            if key in TIMING:
+                continue  # speedup is left out when real ms rounds to 0
+            print("%s: missing, want %s" % (key, value))
+            failed += 1
+        elif not fnmatch.fnmatchcase(got[key], value):
+            print("%s: %s, want %s" % (key, got[key], value))
+            failed += 1
+    for key in got:
+        if key not in dict(want) and key not in TIMING:
+            print("%s: new, %s" % (key, got[key]))
+            failed += 1
+
+    print("%d lines differ from %s" % (failed, golden) if failed else "replay matches %s" % golden)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()